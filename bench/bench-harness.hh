@@ -0,0 +1,210 @@
+// The parts that filter-bench and message-bench have in common: timing a benchmark,
+// counting its heap allocations, parsing the command line and printing the results
+// as CSV or JSON.
+//
+// This header replaces the global 'operator new' and 'operator delete', so it must be
+// included by exactly one source file of a benchmark program.
+
+#pragma once
+
+#include <click/config.h>
+#include <chrono>
+#include <memory>
+#include <new>
+
+namespace
+{
+
+/// The number of heap allocations so far. See the 'operator new' overloads below.
+uint64_t allocation_count = 0;
+
+/// A sink for benchmark results, which keeps the compiler from optimizing away the
+/// code under test.
+volatile uint64_t sink;
+
+/// The work that a benchmark body did in one batch: a number of operations and,
+/// for benchmarks that process messages, the number of bytes in them.
+struct BenchWork
+{
+    BenchWork(uint64_t operations, uint64_t bytes = 0)
+        : operations(operations), bytes(bytes)
+    {
+    }
+
+    uint64_t operations;
+    uint64_t bytes;
+};
+
+/// A single benchmark measurement. 'size' is the benchmark's first grid parameter,
+/// e.g., the number of groups or the number of group records.
+struct Measurement
+{
+    const char *benchmark;
+    int size;
+    int sources;
+    uint64_t operations;
+    uint64_t bytes;
+    double seconds;
+    uint64_t allocations;
+};
+
+/// Runs a benchmark. Every batch sets up a fresh state, which is not timed, and
+/// then runs the body on it, which is. The body returns the work it did. Batches are
+/// repeated until the body has run for at least 'min_time_ms' milliseconds in total.
+/// Only allocations made by the body are counted.
+template <typename TSetup, typename TBody>
+Measurement run_benchmark(
+    const char *benchmark, int size, int sources, int min_time_ms,
+    const TSetup &setup, const TBody &body)
+{
+    typedef std::chrono::steady_clock clock;
+
+    uint64_t operations = 0;
+    uint64_t bytes = 0;
+    uint64_t allocations = 0;
+    clock::duration elapsed = clock::duration::zero();
+    do
+    {
+        auto state = setup();
+        uint64_t allocations_before = allocation_count;
+        auto start = clock::now();
+        BenchWork work = body(*state);
+        elapsed += clock::now() - start;
+        allocations += allocation_count - allocations_before;
+        operations += work.operations;
+        bytes += work.bytes;
+    } while (elapsed < std::chrono::milliseconds(min_time_ms));
+
+    double seconds = std::chrono::duration<double>(elapsed).count();
+    return {benchmark, size, sources, operations, bytes, seconds, allocations};
+}
+
+/// The state of a benchmark that needs no setup.
+struct NoBenchState
+{
+};
+
+/// Runs a benchmark whose body needs no state of its own.
+template <typename TBody>
+Measurement run_benchmark(const char *benchmark, int size, int sources, int min_time_ms, const TBody &body)
+{
+    return run_benchmark(
+        benchmark, size, sources, min_time_ms,
+        []() { return std::unique_ptr<NoBenchState>(new NoBenchState()); },
+        [&](NoBenchState &) { return body(); });
+}
+
+/// The command-line options that every benchmark takes.
+struct BenchOptions
+{
+    bool json = false;
+    int min_time_ms = 50;
+};
+
+/// Parses a benchmark's command line. Prints a usage message and returns false if
+/// the command line is invalid.
+bool parse_bench_options(int argc, char **argv, BenchOptions &options)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--format") == 0 && i + 1 < argc)
+        {
+            options.json = strcmp(argv[++i], "json") == 0;
+        }
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc)
+        {
+            options.min_time_ms = atoi(argv[++i]);
+        }
+        else
+        {
+            fprintf(stderr, "usage: %s [--format csv|json] [--min-time-ms N]\n", argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Prints measurements as CSV or JSON, one row per measurement. 'size_column' names
+/// the benchmarks' first grid parameter. Throughput in bytes is only printed if
+/// 'with_bytes' is set.
+void print_measurements(
+    const Vector<Measurement> &measurements, const BenchOptions &options, const char *size_column, bool with_bytes)
+{
+    if (options.json)
+    {
+        printf("[\n");
+        for (int i = 0; i < measurements.size(); i++)
+        {
+            const auto &m = measurements[i];
+            printf(
+                "  {\"benchmark\": \"%s\", \"%s\": %d, \"sources\": %d, \"operations\": %llu, \"ns_per_op\": %.2f, ",
+                m.benchmark, size_column, m.size, m.sources, (unsigned long long)m.operations,
+                m.seconds * 1e9 / m.operations);
+            if (with_bytes)
+            {
+                printf("\"bytes_per_sec\": %.0f, ", m.bytes / m.seconds);
+            }
+            printf(
+                "\"allocations_per_op\": %.2f}%s\n",
+                (double)m.allocations / m.operations, i + 1 < measurements.size() ? "," : "");
+        }
+        printf("]\n");
+    }
+    else
+    {
+        printf(
+            "benchmark,%s,sources,operations,ns_per_op,%sallocations_per_op\n",
+            size_column, with_bytes ? "bytes_per_sec," : "");
+        for (const auto &m : measurements)
+        {
+            printf(
+                "%s,%d,%d,%llu,%.2f,", m.benchmark, m.size, m.sources, (unsigned long long)m.operations,
+                m.seconds * 1e9 / m.operations);
+            if (with_bytes)
+            {
+                printf("%.0f,", m.bytes / m.seconds);
+            }
+            printf("%.2f\n", (double)m.allocations / m.operations);
+        }
+    }
+}
+
+} // namespace
+
+// Count every heap allocation. Click's 'Vector' and 'String' allocate through
+// 'new', and so do the shim and the filters' pools.
+
+void *operator new(size_t size)
+{
+    allocation_count++;
+    if (void *result = malloc(size ? size : 1))
+    {
+        return result;
+    }
+    throw std::bad_alloc();
+}
+
+void *operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer) noexcept
+{
+    free(pointer);
+}
+
+void operator delete(void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
+
+void operator delete[](void *pointer, size_t) noexcept
+{
+    free(pointer);
+}
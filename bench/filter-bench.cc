@@ -0,0 +1,241 @@
+// Microbenchmarks for the IGMP router and member filters.
+//
+// The filters are header-only, so this benchmark compiles them against the Click
+// shim in 'bench/shim' instead of a full Click build. Every benchmark is run for a
+// grid of group counts and source list sizes. Results are printed as CSV (the
+// default) or as JSON, one row per benchmark and grid point, so they can be diffed
+// across commits. Along with the time per operation, every row has the number of
+// heap allocations per operation; for the 'router.receive' benchmarks, that is the
+// number of allocations it takes to process one group record.
+//
+// Usage: filter-bench [--format csv|json] [--min-time-ms N]
+
+#include <click/config.h>
+#include <memory>
+#include "IgmpMemberFilter.hh"
+#include "IgmpRouterFilter.hh"
+#include "bench-harness.hh"
+
+namespace
+{
+
+/// The element that owns the router filter's timers.
+class BenchElement : public Element
+{
+};
+
+/// The group counts that every benchmark is run for.
+const int group_counts[] = {1, 16, 256, 4096};
+
+/// The source list sizes that every benchmark is run for. 366 is the largest number
+/// of sources that fits in a single group record of an unfragmented report.
+const int source_counts[] = {0, 4, 8, 64, 366};
+
+/// Gets the multicast address of the group with the given index. SSM groups are
+/// taken from 232/8, other groups from 225/8.
+IPAddress make_group(int index, bool ssm = false)
+{
+    return IPAddress(htonl((ssm ? 0xE8000000 : 0xE1000000) | index));
+}
+
+/// Gets the source address with the given index.
+IPAddress make_source(int index)
+{
+    return IPAddress(htonl(0x0A000000 | index));
+}
+
+/// Creates a set of 'count' consecutive source addresses, starting at 'first'.
+IgmpSourceSet make_sources(int first, int count)
+{
+    IgmpSourceSet result;
+    result.reserve(count);
+    for (int i = 0; i < count; i++)
+    {
+        result.append_unsorted(make_source(first + i));
+    }
+    result.normalize();
+    return result;
+}
+
+/// Creates a filter record with the given mode and sources.
+IgmpFilterRecord make_record(IgmpFilterMode filter_mode, const IgmpSourceSet &source_addresses)
+{
+    return {filter_mode, source_addresses};
+}
+
+/// Creates a router filter in which every group has received one current-state
+/// record with the given mode and sources.
+std::unique_ptr<IgmpRouterFilter> make_router_filter(
+    Element *owner, int groups, IgmpFilterMode filter_mode, const IgmpSourceSet &source_addresses,
+    bool ssm)
+{
+    std::unique_ptr<IgmpRouterFilter> filter(new IgmpRouterFilter(owner, true));
+    auto record = make_record(filter_mode, source_addresses);
+    for (int i = 0; i < groups; i++)
+    {
+        filter->receive_current_state_record(make_group(i, ssm), record);
+    }
+    return filter;
+}
+
+/// Benchmarks one branch of 'IgmpRouterFilter::receive_current_state_record'. The
+/// router state is INCLUDE(A) or EXCLUDE({}, A) for every group, and the report
+/// that is received overlaps half of A. If 'ssm' is set, then the groups are SSM
+/// groups, which only support INCLUDE mode.
+Measurement bench_router_receive(
+    const char *benchmark, Element *owner, int groups, int sources, int min_time_ms,
+    IgmpFilterMode router_mode, IgmpFilterMode report_mode, bool ssm = false)
+{
+    auto old_sources = make_sources(0, sources);
+    auto report = make_record(report_mode, make_sources(sources / 2, sources));
+    return run_benchmark(
+        benchmark, groups, sources, min_time_ms,
+        [&]() { return make_router_filter(owner, groups, router_mode, old_sources, ssm); },
+        [&](IgmpRouterFilter &filter) {
+            for (int i = 0; i < groups; i++)
+            {
+                filter.receive_current_state_record(make_group(i, ssm), report);
+            }
+            return (uint64_t)groups;
+        });
+}
+
+/// The number of times the read-only benchmarks query every group per batch, which
+/// keeps the setup cost from dominating short runs.
+const int lookup_passes = 16;
+
+/// Benchmarks 'IgmpRouterFilter::is_listening_to'. The router state is INCLUDE(A)
+/// or EXCLUDE({}, A) for every group. If 'ssm' is set, then the groups are SSM
+/// groups, which only support INCLUDE mode.
+Measurement bench_router_is_listening_to(
+    const char *benchmark, Element *owner, int groups, int sources, int min_time_ms,
+    IgmpFilterMode filter_mode, bool ssm = false)
+{
+    // Query one source that is in A and one that is not for every group.
+    auto source_addresses = make_sources(0, sources);
+    return run_benchmark(
+        benchmark, groups, sources, min_time_ms,
+        [&]() { return make_router_filter(owner, groups, filter_mode, source_addresses, ssm); },
+        [&](IgmpRouterFilter &filter) {
+            uint64_t listening = 0;
+            for (int pass = 0; pass < lookup_passes; pass++)
+            {
+                for (int i = 0; i < groups; i++)
+                {
+                    auto group = make_group(i, ssm);
+                    listening += filter.is_listening_to(group, make_source(sources == 0 ? 0 : i % sources));
+                    listening += filter.is_listening_to(group, make_source(sources + i));
+                }
+            }
+            sink = listening;
+            return (uint64_t)lookup_passes * groups * 2;
+        });
+}
+
+/// Creates a member filter that listens to every group with the given sources.
+std::unique_ptr<IgmpMemberFilter> make_member_filter(int groups, const IgmpSourceSet &source_addresses)
+{
+    std::unique_ptr<IgmpMemberFilter> filter(new IgmpMemberFilter());
+    auto filter_mode = source_addresses.empty() ? IgmpFilterMode::Exclude : IgmpFilterMode::Include;
+    for (int i = 0; i < groups; i++)
+    {
+        filter->listen(make_group(i), filter_mode, source_addresses);
+    }
+    return filter;
+}
+
+Measurement bench_member_listen(int groups, int sources, int min_time_ms)
+{
+    // Change every group's source list to one that overlaps half of the old list.
+    auto old_sources = make_sources(0, sources);
+    auto new_sources = make_sources(sources / 2, sources);
+    return run_benchmark(
+        "member.listen", groups, sources, min_time_ms,
+        [&]() { return make_member_filter(groups, old_sources); },
+        [&](IgmpMemberFilter &filter) {
+            uint64_t changes = 0;
+            for (int i = 0; i < groups; i++)
+            {
+                changes += filter.listen(make_group(i), IgmpFilterMode::Exclude, new_sources);
+            }
+            sink = changes;
+            return (uint64_t)groups;
+        });
+}
+
+Measurement bench_member_is_listening_to(int groups, int sources, int min_time_ms)
+{
+    auto source_addresses = make_sources(0, sources);
+    return run_benchmark(
+        "member.is_listening_to", groups, sources, min_time_ms,
+        [&]() { return make_member_filter(groups, source_addresses); },
+        [&](IgmpMemberFilter &filter) {
+            uint64_t listening = 0;
+            for (int pass = 0; pass < lookup_passes; pass++)
+            {
+                for (int i = 0; i < groups; i++)
+                {
+                    auto group = make_group(i);
+                    listening += filter.is_listening_to(group, make_source(sources == 0 ? 0 : i % sources));
+                    listening += filter.is_listening_to(group, make_source(sources + i));
+                }
+            }
+            sink = listening;
+            return (uint64_t)lookup_passes * groups * 2;
+        });
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parse_bench_options(argc, argv, options))
+    {
+        return 1;
+    }
+    int min_time_ms = options.min_time_ms;
+
+    // Use a fixed seed, so hash tables are laid out the same way on every run.
+    srandom(1);
+
+    fprintf(stderr, "filter-bench: source search kernel: %s\n", igmp_find_word_kernel_name());
+
+    BenchElement owner;
+    Vector<Measurement> measurements;
+    for (int groups : group_counts)
+    {
+        for (int sources : source_counts)
+        {
+            measurements.push_back(bench_router_is_listening_to(
+                "router.is_listening_to.include", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Include));
+            measurements.push_back(bench_router_is_listening_to(
+                "router.is_listening_to.exclude", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Exclude));
+            measurements.push_back(bench_router_is_listening_to(
+                "router.is_listening_to.ssm", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Include, true));
+            measurements.push_back(bench_router_receive(
+                "router.receive.include_is_in", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Include, IgmpFilterMode::Include));
+            measurements.push_back(bench_router_receive(
+                "router.receive.include_is_ex", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Include, IgmpFilterMode::Exclude));
+            measurements.push_back(bench_router_receive(
+                "router.receive.exclude_is_in", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Exclude, IgmpFilterMode::Include));
+            measurements.push_back(bench_router_receive(
+                "router.receive.exclude_is_ex", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Exclude, IgmpFilterMode::Exclude));
+            measurements.push_back(bench_router_receive(
+                "router.receive.ssm_is_in", &owner, groups, sources, min_time_ms,
+                IgmpFilterMode::Include, IgmpFilterMode::Include, true));
+            measurements.push_back(bench_member_listen(groups, sources, min_time_ms));
+            measurements.push_back(bench_member_is_listening_to(groups, sources, min_time_ms));
+        }
+    }
+
+    print_measurements(measurements, options, "groups", false);
+    return 0;
+}
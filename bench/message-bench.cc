@@ -0,0 +1,414 @@
+// Benchmarks for the IGMP message views in IgmpMessageView.hh, which the elements
+// parse incoming messages with, for the parsers and serializers in
+// IgmpMessageManip.hh and for IGMP checksum verification.
+//
+// Like filter-bench, this compiles the header-only message code against the Click
+// shim in 'bench/shim'. Every benchmark runs over a synthetic corpus of messages:
+// queries with 0 to 366 sources and reports with 1 to 1000 group records of 0 to
+// 366 sources each. Results are printed as CSV (the default) or as JSON, with the
+// time per message, the throughput in bytes per second and the number of heap
+// allocations per message.
+//
+// Usage: message-bench [--format csv|json] [--min-time-ms N]
+
+#include <click/config.h>
+#include "IgmpMessage.hh"
+#include "IgmpMessageManip.hh"
+#include "IgmpMessageView.hh"
+#include "bench-harness.hh"
+
+namespace
+{
+
+/// The group record counts of the report corpora.
+const int record_counts[] = {1, 10, 100, 1000};
+
+/// The source counts of the query corpora and of the group records in the report
+/// corpora.
+const int source_counts[] = {0, 1, 16, 366};
+
+/// The number of distinct messages in a corpus.
+const int corpus_size = 16;
+
+/// Gets a random unicast source address.
+IPAddress random_source()
+{
+    return IPAddress(htonl(0x0A000000 | (click_random() & 0x00FFFFFF)));
+}
+
+/// Gets a random multicast group address.
+IPAddress random_group()
+{
+    return IPAddress(htonl(0xE1000000 | (click_random() & 0x00FFFFFF)));
+}
+
+IgmpSourceSet random_sources(int count)
+{
+    IgmpSourceSet result;
+    while (result.size() < count)
+    {
+        result.insert(random_source());
+    }
+    return result;
+}
+
+/// A set of messages along with their wire format.
+template <typename TMessage>
+struct Corpus
+{
+    Vector<TMessage> messages;
+    Vector<Vector<unsigned char>> buffers;
+    size_t total_bytes;
+};
+
+template <typename TMessage>
+Corpus<TMessage> make_corpus(const Vector<TMessage> &messages)
+{
+    Corpus<TMessage> result;
+    result.messages = messages;
+    result.total_bytes = 0;
+    for (const auto &message : messages)
+    {
+        Vector<unsigned char> buffer(message.get_size(), 0);
+        unsigned char *end = message.write(buffer.begin());
+        assert(end == buffer.end());
+        (void)end;
+        update_igmp_checksum(buffer.begin(), buffer.size());
+        result.buffers.push_back(buffer);
+        result.total_bytes += buffer.size();
+    }
+    return result;
+}
+
+Corpus<IgmpMembershipQuery> make_query_corpus(int sources)
+{
+    Vector<IgmpMembershipQuery> queries;
+    for (int i = 0; i < corpus_size; i++)
+    {
+        IgmpMembershipQuery query;
+        query.max_resp_time = click_random(0, 1000);
+        query.group_address = random_group();
+        query.robustness_variable = click_random(1, 7);
+        query.query_interval = click_random(0, 1000);
+        query.source_addresses = random_sources(sources);
+        queries.push_back(query);
+    }
+    return make_corpus(queries);
+}
+
+Corpus<IgmpV3MembershipReport> make_report_corpus(int records, int sources)
+{
+    static const IgmpV3GroupRecordType record_types[] = {
+        IgmpV3GroupRecordType::ModeIsInclude,
+        IgmpV3GroupRecordType::ModeIsExclude,
+        IgmpV3GroupRecordType::ChangeToIncludeMode,
+        IgmpV3GroupRecordType::ChangeToExcludeMode};
+
+    Vector<IgmpV3MembershipReport> reports;
+    for (int i = 0; i < corpus_size; i++)
+    {
+        IgmpV3MembershipReport report;
+        for (int j = 0; j < records; j++)
+        {
+            IgmpV3GroupRecord record;
+            record.type = record_types[click_random(0, 3)];
+            record.multicast_address = random_group();
+            record.source_addresses = random_sources(sources);
+            report.group_records.push_back(record);
+        }
+        reports.push_back(report);
+    }
+    return make_corpus(reports);
+}
+
+/// Tests if two parsed messages are equal. Only used to check that the corpora
+/// survive a round trip through the serializer and the parser.
+bool equals(const IgmpMembershipQuery &left, const IgmpMembershipQuery &right)
+{
+    return left.group_address == right.group_address
+        && left.robustness_variable == right.robustness_variable
+        && left.source_addresses == right.source_addresses;
+}
+
+bool equals(const IgmpV3MembershipReport &left, const IgmpV3MembershipReport &right)
+{
+    if (left.group_records.size() != right.group_records.size())
+    {
+        return false;
+    }
+    for (int i = 0; i < left.group_records.size(); i++)
+    {
+        const auto &left_record = left.group_records[i];
+        const auto &right_record = right.group_records[i];
+        if (left_record.type != right_record.type
+            || left_record.multicast_address != right_record.multicast_address
+            || left_record.source_addresses != right_record.source_addresses)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Checks that every message in the corpus parses to itself.
+template <typename TMessage>
+void check_round_trip(const Corpus<TMessage> &corpus)
+{
+    for (int i = 0; i < corpus.messages.size(); i++)
+    {
+        const unsigned char *buffer = corpus.buffers[i].begin();
+        if (!equals(TMessage::read(buffer), corpus.messages[i]) || buffer != corpus.buffers[i].end())
+        {
+            fprintf(stderr, "message-bench: corpus message %d does not survive a round trip\n", i);
+            exit(1);
+        }
+    }
+}
+
+/// Tests if a source list view holds the same addresses as a source set.
+bool equals(const IgmpSourceListView &view, const IgmpSourceSet &source_addresses)
+{
+    if (view.size() != source_addresses.size())
+    {
+        return false;
+    }
+    int i = 0;
+    for (auto address : view)
+    {
+        if (address != source_addresses.begin()[i++])
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Tests if a view of a message's wire format agrees with the message. Only used to
+/// check that the views see the corpora the way the parsers do.
+bool view_equals(const unsigned char *data, size_t length, const IgmpMembershipQuery &query)
+{
+    IgmpMembershipQueryView view(data, length);
+    return view.valid()
+        && view.get_size() == length
+        && view.get_group_address() == query.group_address
+        && view.get_robustness_variable() == query.robustness_variable
+        && equals(view.get_source_addresses(), query.source_addresses);
+}
+
+bool view_equals(const unsigned char *data, size_t length, const IgmpV3MembershipReport &report)
+{
+    IgmpV3MembershipReportView view(data, length);
+    if (!view.valid() || view.get_size() != length || view.get_number_of_group_records() != report.group_records.size())
+    {
+        return false;
+    }
+    int i = 0;
+    for (auto group : view)
+    {
+        const auto &record = report.group_records[i++];
+        if (group.get_type() != record.type
+            || group.get_multicast_address() != record.multicast_address
+            || !equals(group.get_source_addresses(), record.source_addresses))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/// Checks that every message in the corpus has a correct checksum and that its view
+/// agrees with the message.
+template <typename TMessage>
+void check_views(const Corpus<TMessage> &corpus)
+{
+    for (int i = 0; i < corpus.messages.size(); i++)
+    {
+        const auto &buffer = corpus.buffers[i];
+        if (!verify_igmp_checksum(buffer.begin(), buffer.size())
+            || !view_equals(buffer.begin(), buffer.size(), corpus.messages[i]))
+        {
+            fprintf(stderr, "message-bench: corpus message %d does not match its view\n", i);
+            exit(1);
+        }
+    }
+}
+
+/// Benchmarks 'IgmpMembershipQueryView': validates every query and reads its header
+/// fields and source addresses, like 'IgmpRouterInterface' and 'IgmpGroupMember' do.
+Measurement bench_query_view(int sources, int min_time_ms, const Corpus<IgmpMembershipQuery> &corpus)
+{
+    return run_benchmark("query.view", 0, sources, min_time_ms, [&]() {
+        uint64_t sum = 0;
+        for (const auto &buffer : corpus.buffers)
+        {
+            IgmpMembershipQueryView query(buffer.begin(), buffer.size());
+            if (!query.valid())
+            {
+                continue;
+            }
+            sum += query.get_group_address().addr() + query.get_max_resp_time() + query.get_query_interval();
+            for (auto address : query.get_source_addresses())
+            {
+                sum += address.addr();
+            }
+        }
+        sink = sum;
+        return BenchWork(corpus.buffers.size(), corpus.total_bytes);
+    });
+}
+
+/// Benchmarks 'IgmpV3MembershipReportView': validates every report and walks all
+/// of its group records and their source addresses, like 'IgmpRouterInterface' does.
+Measurement bench_report_view(int records, int sources, int min_time_ms, const Corpus<IgmpV3MembershipReport> &corpus)
+{
+    return run_benchmark("report.view", records, sources, min_time_ms, [&]() {
+        uint64_t sum = 0;
+        for (const auto &buffer : corpus.buffers)
+        {
+            IgmpV3MembershipReportView report(buffer.begin(), buffer.size());
+            if (!report.valid())
+            {
+                continue;
+            }
+            for (auto group : report)
+            {
+                sum += (uint64_t)group.get_type() + group.get_multicast_address().addr();
+                for (auto address : group.get_source_addresses())
+                {
+                    sum += address.addr();
+                }
+            }
+        }
+        sink = sum;
+        return BenchWork(corpus.buffers.size(), corpus.total_bytes);
+    });
+}
+
+/// Benchmarks 'verify_igmp_checksum', which checks a message's checksum in place.
+template <typename TMessage>
+Measurement bench_verify_checksum(
+    const char *benchmark, int records, int sources, int min_time_ms, const Corpus<TMessage> &corpus)
+{
+    return run_benchmark(benchmark, records, sources, min_time_ms, [&]() {
+        uint64_t valid = 0;
+        for (const auto &buffer : corpus.buffers)
+        {
+            valid += verify_igmp_checksum(buffer.begin(), buffer.size());
+        }
+        sink = valid;
+        return BenchWork(corpus.buffers.size(), corpus.total_bytes);
+    });
+}
+
+template <typename TMessage>
+Measurement bench_read(const char *benchmark, int records, int sources, int min_time_ms, const Corpus<TMessage> &corpus)
+{
+    return run_benchmark(benchmark, records, sources, min_time_ms, [&]() {
+        for (const auto &buffer : corpus.buffers)
+        {
+            const unsigned char *data = buffer.begin();
+            auto message = TMessage::read(data);
+            sink = message.get_size();
+        }
+        return BenchWork(corpus.buffers.size(), corpus.total_bytes);
+    });
+}
+
+template <typename TMessage>
+Measurement bench_write(const char *benchmark, int records, int sources, int min_time_ms, const Corpus<TMessage> &corpus)
+{
+    int max_size = 0;
+    for (const auto &buffer : corpus.buffers)
+    {
+        max_size = buffer.size() > max_size ? buffer.size() : max_size;
+    }
+    Vector<unsigned char> output(max_size, 0);
+
+    return run_benchmark(benchmark, records, sources, min_time_ms, [&]() {
+        for (const auto &message : corpus.messages)
+        {
+            sink = message.write(output.begin()) - output.begin();
+        }
+        return BenchWork(corpus.messages.size(), corpus.total_bytes);
+    });
+}
+
+Measurement bench_group_record_get_size(int records, int sources, int min_time_ms, const Corpus<IgmpV3MembershipReport> &corpus)
+{
+    return run_benchmark("group_record.get_size", records, sources, min_time_ms, [&]() {
+        size_t size = 0;
+        for (const auto &report : corpus.messages)
+        {
+            for (const auto &record : report.group_records)
+            {
+                size += record.get_size();
+            }
+        }
+        sink = size;
+        return BenchWork(corpus.messages.size(), corpus.total_bytes);
+    });
+}
+
+Measurement bench_value_to_code(int min_time_ms)
+{
+    // Every value that fits in a 16-bit field: small values map to themselves,
+    // larger ones need a floating-point code.
+    const unsigned int max_value = 32767;
+    return run_benchmark("igmp_value_to_code", 0, 0, min_time_ms, [&]() {
+        unsigned int codes = 0;
+        for (unsigned int value = 0; value <= max_value; value++)
+        {
+            codes += igmp_value_to_code(value);
+        }
+        sink = codes;
+        return BenchWork(max_value + 1);
+    });
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    if (!parse_bench_options(argc, argv, options))
+    {
+        return 1;
+    }
+    int min_time_ms = options.min_time_ms;
+
+    // Use a fixed seed, so every run sees the same corpora.
+    srandom(1);
+
+    Vector<Measurement> measurements;
+    for (int sources : source_counts)
+    {
+        auto corpus = make_query_corpus(sources);
+        check_round_trip(corpus);
+        check_views(corpus);
+        measurements.push_back(bench_query_view(sources, min_time_ms, corpus));
+        measurements.push_back(bench_verify_checksum("query.verify_checksum", 0, sources, min_time_ms, corpus));
+        measurements.push_back(bench_read("query.read", 0, sources, min_time_ms, corpus));
+        measurements.push_back(bench_write("query.write", 0, sources, min_time_ms, corpus));
+    }
+
+    for (int records : record_counts)
+    {
+        for (int sources : source_counts)
+        {
+            auto corpus = make_report_corpus(records, sources);
+            check_round_trip(corpus);
+            check_views(corpus);
+            measurements.push_back(bench_report_view(records, sources, min_time_ms, corpus));
+            measurements.push_back(bench_verify_checksum(
+                "report.verify_checksum", records, sources, min_time_ms, corpus));
+            measurements.push_back(bench_read("report.read", records, sources, min_time_ms, corpus));
+            measurements.push_back(bench_write("report.write", records, sources, min_time_ms, corpus));
+            measurements.push_back(bench_group_record_get_size(records, sources, min_time_ms, corpus));
+        }
+    }
+
+    measurements.push_back(bench_value_to_code(min_time_ms));
+
+    print_measurements(measurements, options, "records", true);
+    return 0;
+}
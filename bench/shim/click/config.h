@@ -0,0 +1,17 @@
+#pragma once
+
+// A minimal stand-in for Click's configuration header. The shim in this directory
+// implements just enough of Click 2.0.1 to compile the header-only parts of
+// 'elements/' without a Click install. It is only used by the benchmarks.
+
+#include <assert.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <arpa/inet.h>
+
+#define CLICK_DECLS
+#define CLICK_ENDDECLS
+#define CLICK_SIZE_PACKED_ATTRIBUTE __attribute__((packed))
@@ -0,0 +1,14 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/timer.hh>
+#include <click/vector.hh>
+
+/// A stand-in for Click's 'Element'. The filters only use elements as timer owners.
+class Element
+{
+  public:
+    virtual ~Element() {}
+};
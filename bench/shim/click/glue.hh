@@ -0,0 +1,29 @@
+#pragma once
+
+#include <click/config.h>
+#include <stdarg.h>
+
+/// Click prints diagnostics with 'click_chatter'. The benchmarks discard them.
+inline void click_chatter(const char *, ...)
+{
+}
+
+inline uint32_t click_random()
+{
+    return (uint32_t)random();
+}
+
+inline uint32_t click_random(uint32_t low, uint32_t high)
+{
+    return low + (uint32_t)random() % (high - low + 1);
+}
+
+/// Click's 'click_qsort' takes an extra user data argument, which 'qsort_r'
+/// conveniently also does.
+inline int click_qsort(
+    void *base, size_t count, size_t size,
+    int (*compare)(const void *, const void *, void *), void *user_data = nullptr)
+{
+    qsort_r(base, count, size, compare, user_data);
+    return 0;
+}
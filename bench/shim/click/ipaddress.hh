@@ -0,0 +1,40 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <netinet/in.h>
+
+/// A stand-in for Click's 'IPAddress'. Addresses are stored in network byte order.
+class IPAddress
+{
+  public:
+    IPAddress() : address(0) {}
+    IPAddress(uint32_t address) : address(address) {}
+    IPAddress(struct in_addr address) : address(address.s_addr) {}
+    explicit IPAddress(const char *text) : address(0) { inet_pton(AF_INET, text, &address); }
+
+    uint32_t addr() const { return address; }
+    operator struct in_addr() const
+    {
+        struct in_addr result;
+        result.s_addr = address;
+        return result;
+    }
+
+    bool empty() const { return address == 0; }
+    bool is_multicast() const { return (ntohl(address) & 0xF0000000) == 0xE0000000; }
+    uint32_t hashcode() const { return address; }
+
+    String unparse() const
+    {
+        char buffer[INET_ADDRSTRLEN];
+        inet_ntop(AF_INET, &address, buffer, sizeof(buffer));
+        return String(buffer);
+    }
+
+    friend bool operator==(IPAddress left, IPAddress right) { return left.address == right.address; }
+    friend bool operator!=(IPAddress left, IPAddress right) { return left.address != right.address; }
+
+  private:
+    uint32_t address;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <click/config.h>
+#include <string>
+
+/// A stand-in for Click's 'String', backed by 'std::string'.
+class String
+{
+  public:
+    typedef unsigned long long uint_large_t;
+
+    String() {}
+    String(const char *value) : value(value) {}
+    String(const char *value, int length) : value(value, length) {}
+    String(const std::string &value) : value(value) {}
+    String(int value) : value(std::to_string(value)) {}
+    String(unsigned value) : value(std::to_string(value)) {}
+    String(long value) : value(std::to_string(value)) {}
+    String(unsigned long value) : value(std::to_string(value)) {}
+    String(long long value) : value(std::to_string(value)) {}
+    String(unsigned long long value) : value(std::to_string(value)) {}
+
+    static String make_numeric(uint_large_t number, int base = 10, bool uppercase = true)
+    {
+        char buffer[32];
+        snprintf(buffer, sizeof(buffer), base == 16 ? (uppercase ? "%llX" : "%llx") : "%llu", number);
+        return String(buffer);
+    }
+
+    const char *c_str() const { return value.c_str(); }
+    const char *data() const { return value.data(); }
+    int length() const { return (int)value.size(); }
+    bool empty() const { return value.empty(); }
+
+    String &operator+=(const String &other)
+    {
+        value += other.value;
+        return *this;
+    }
+
+    friend String operator+(String left, const String &right) { return left += right; }
+    friend String operator+(const char *left, const String &right) { return String(left) += right; }
+    friend bool operator==(const String &left, const String &right) { return left.value == right.value; }
+    friend bool operator!=(const String &left, const String &right) { return left.value != right.value; }
+
+  private:
+    std::string value;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/timestamp.hh>
+
+class Element;
+class Timer;
+
+typedef void (*TimerCallback)(Timer *, void *);
+
+/// A stand-in for Click's 'Timer'. It keeps track of its schedule, but there is
+/// no event loop to fire it: benchmarks measure the cost of scheduling, not of
+/// timer callbacks.
+class Timer
+{
+  public:
+    Timer()
+        : callback(nullptr), user_data(nullptr), owner(nullptr), is_scheduled(false)
+    {
+    }
+
+    Timer(TimerCallback callback, void *user_data)
+        : callback(callback), user_data(user_data), owner(nullptr), is_scheduled(false)
+    {
+    }
+
+    Timer(const Timer &) = delete;
+    Timer &operator=(const Timer &) = delete;
+
+    void initialize(Element *owner, bool = false) { this->owner = owner; }
+    bool initialized() const { return owner != nullptr; }
+    bool scheduled() const { return is_scheduled; }
+    Timestamp expiry_steady() const { return expiry; }
+
+    void schedule_at_steady(const Timestamp &when)
+    {
+        expiry = when;
+        is_scheduled = true;
+    }
+
+    void schedule_after_sec(uint32_t delta_sec)
+    {
+        schedule_at_steady(Timestamp::recent_steady() + Timestamp::make_sec(delta_sec));
+    }
+
+    void schedule_after_msec(uint32_t delta_msec)
+    {
+        schedule_at_steady(Timestamp::recent_steady() + Timestamp::make_msec(delta_msec));
+    }
+
+    void reschedule_after_msec(uint32_t delta_msec)
+    {
+        schedule_at_steady(expiry + Timestamp::make_msec(delta_msec));
+    }
+
+    void unschedule() { is_scheduled = false; }
+
+  private:
+    TimerCallback callback;
+    void *user_data;
+    Element *owner;
+    bool is_scheduled;
+    Timestamp expiry;
+};
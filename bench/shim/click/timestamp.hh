@@ -0,0 +1,51 @@
+#pragma once
+
+#include <click/config.h>
+
+/// A stand-in for Click's 'Timestamp'. The steady clock is a counter that only
+/// moves when the benchmark advances it, so timer-dependent results are
+/// reproducible.
+class Timestamp
+{
+  public:
+    typedef int64_t value_type;
+
+    Timestamp() : nsec(0) {}
+
+    static Timestamp make_nsec(value_type nsec)
+    {
+        Timestamp result;
+        result.nsec = nsec;
+        return result;
+    }
+
+    static Timestamp make_msec(value_type msec) { return make_nsec(msec * 1000000); }
+    static Timestamp make_sec(value_type sec) { return make_nsec(sec * 1000000000); }
+
+    static Timestamp &steady_clock()
+    {
+        static Timestamp clock = make_sec(1);
+        return clock;
+    }
+
+    static Timestamp recent_steady() { return steady_clock(); }
+    static Timestamp now_steady() { return steady_clock(); }
+
+    value_type sec() const { return nsec / 1000000000; }
+    /// Like Click's 'msec', this is only the subsecond part of the timestamp.
+    uint32_t msec() const { return (nsec / 1000000) % 1000; }
+    value_type msecval() const { return nsec / 1000000; }
+    value_type nsecval() const { return nsec; }
+
+    friend Timestamp operator+(Timestamp left, Timestamp right) { return make_nsec(left.nsec + right.nsec); }
+    friend Timestamp operator-(Timestamp left, Timestamp right) { return make_nsec(left.nsec - right.nsec); }
+    friend bool operator==(Timestamp left, Timestamp right) { return left.nsec == right.nsec; }
+    friend bool operator!=(Timestamp left, Timestamp right) { return left.nsec != right.nsec; }
+    friend bool operator<(Timestamp left, Timestamp right) { return left.nsec < right.nsec; }
+    friend bool operator<=(Timestamp left, Timestamp right) { return left.nsec <= right.nsec; }
+    friend bool operator>(Timestamp left, Timestamp right) { return left.nsec > right.nsec; }
+    friend bool operator>=(Timestamp left, Timestamp right) { return left.nsec >= right.nsec; }
+
+  private:
+    value_type nsec;
+};
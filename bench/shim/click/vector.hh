@@ -0,0 +1,69 @@
+#pragma once
+
+#include <click/config.h>
+#include <vector>
+
+/// A stand-in for Click's 'Vector'. Like the original, it has 'int' sizes and
+/// pointer iterators, and 'clear' keeps the allocated storage.
+template <typename T>
+class Vector
+{
+  public:
+    typedef T value_type;
+    typedef int size_type;
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    Vector() {}
+    explicit Vector(size_type count, const T &value) : items(count, value) {}
+
+    size_type size() const { return (size_type)items.size(); }
+    bool empty() const { return items.empty(); }
+
+    iterator begin() { return items.data(); }
+    iterator end() { return items.data() + items.size(); }
+    const_iterator begin() const { return items.data(); }
+    const_iterator end() const { return items.data() + items.size(); }
+
+    T &operator[](size_type index) { return items[index]; }
+    const T &operator[](size_type index) const { return items[index]; }
+    T &at(size_type index) { return items.at(index); }
+    const T &at(size_type index) const { return items.at(index); }
+    T &front() { return items.front(); }
+    const T &front() const { return items.front(); }
+    T &back() { return items.back(); }
+    const T &back() const { return items.back(); }
+
+    void push_back(const T &value) { items.push_back(value); }
+    void pop_back() { items.pop_back(); }
+    void clear() { items.clear(); }
+    bool reserve(size_type count)
+    {
+        items.reserve(count);
+        return true;
+    }
+    void resize(size_type count, const T &value = T()) { items.resize(count, value); }
+    void swap(Vector &other) { items.swap(other.items); }
+
+    iterator insert(iterator position, const T &value)
+    {
+        size_t index = position - begin();
+        items.insert(items.begin() + index, value);
+        return begin() + index;
+    }
+
+    iterator erase(iterator position)
+    {
+        return erase(position, position + 1);
+    }
+
+    iterator erase(iterator first, iterator last)
+    {
+        size_t index = first - begin();
+        items.erase(items.begin() + index, items.begin() + (last - begin()));
+        return begin() + index;
+    }
+
+  private:
+    std::vector<T> items;
+};
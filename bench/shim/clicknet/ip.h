@@ -0,0 +1,4 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/ipaddress.hh>
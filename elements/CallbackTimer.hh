@@ -9,41 +9,70 @@ CLICK_DECLS
 /// A timer that with a strongly-typed callback. Both the timer and
 /// the callback's resources are reclaimed once they are no longer
 /// necessary.
+///
+/// Copies of a callback timer share the same Click timer. The timer and its
+/// callback live in a single reference-counted block, which can be drawn from
+/// a pool with 'allocate_in'.
 template <typename TCallback>
 class CallbackTimer final
 {
   public:
+    /// The state that a timer shares with its copies.
+    struct State final
+    {
+        template <typename... TArgs>
+        State(const TArgs &... args)
+            : callback(args...), timer(&callback_thunk, &callback)
+        {
+        }
+
+        State(const State &) = delete;
+        State &operator=(const State &) = delete;
+
+        TCallback callback;
+        Timer timer;
+    };
+
+    /// A pool of blocks for callback timers.
+    typedef RcPool<State> pool_type;
+
     template <typename... TArgs>
     CallbackTimer(const TArgs &... args)
-        : callback(args...)
+        : state(args...)
+    {
+    }
+
+    /// Creates a callback timer whose state is allocated from the given pool.
+    template <typename... TArgs>
+    static CallbackTimer<TCallback> allocate_in(pool_type &pool, const TArgs &... args)
     {
-        timer = make_rc<Timer>(&callback_thunk, callback.get());
+        return CallbackTimer<TCallback>(Rc<State>::allocate_in(pool, args...));
     }
 
     /// Initializes this timer by assigning it to an owner.
     void initialize(Element *owner)
     {
-        timer->initialize(owner);
+        state->timer.initialize(owner);
     }
 
     /// Tests if this timer has been initialized yet.
     bool initialized() const
     {
-        return timer->initialized();
+        return state->timer.initialized();
     }
 
     /// Tests if this timer is scheduled to expire at some point.
     bool scheduled() const
     {
-        return timer->scheduled();
+        return state->timer.scheduled();
     }
 
     /// Schedules the timer to fire after the given amount of seconds.
     void schedule_after_sec(uint32_t delta_sec)
     {
-        if (timer->initialized())
+        if (state->timer.initialized())
         {
-            timer->schedule_after_sec(delta_sec);
+            state->timer.schedule_after_sec(delta_sec);
         }
     }
 
@@ -56,9 +85,18 @@ class CallbackTimer final
     /// Schedules the timer to fire after the given amount of milliseconds.
     void schedule_after_msec(uint32_t delta_msec)
     {
-        if (timer->initialized())
+        if (state->timer.initialized())
         {
-            timer->schedule_after_msec(delta_msec);
+            state->timer.schedule_after_msec(delta_msec);
+        }
+    }
+
+    /// Schedules the timer to fire at the given steady timestamp.
+    void schedule_at_steady(const Timestamp &expiry)
+    {
+        if (state->timer.initialized())
+        {
+            state->timer.schedule_at_steady(expiry);
         }
     }
 
@@ -73,25 +111,31 @@ class CallbackTimer final
     /// past the previous expiration time.
     void reschedule_after_msec(uint32_t delta_msec)
     {
-        if (timer->initialized())
+        if (state->timer.initialized())
         {
-            timer->reschedule_after_msec(delta_msec);
+            state->timer.reschedule_after_msec(delta_msec);
         }
     }
 
     /// Unschedules this timer.
     void unschedule()
     {
-        if (timer->initialized())
+        if (state->timer.initialized())
         {
-            timer->unschedule();
+            state->timer.unschedule();
         }
     }
 
+    /// Gets the steady timestamp at which this timer fires.
+    Timestamp expiry_steady() const
+    {
+        return state->timer.expiry_steady();
+    }
+
     /// Gets the amount of time remaining until this timer fires, in milliseconds.
     uint32_t remaining_time_msec() const
     {
-        return (timer->expiry_steady() - Timestamp::recent_steady()).msec();
+        return (state->timer.expiry_steady() - Timestamp::recent_steady()).msec();
     }
 
     /// Gets the amount of time remaining until this timer fires, in deciseconds.
@@ -101,14 +145,18 @@ class CallbackTimer final
     }
 
   private:
+    explicit CallbackTimer(Rc<State> &&state)
+        : state(static_cast<Rc<State> &&>(state))
+    {
+    }
+
     static void callback_thunk(Timer *, void *data)
     {
         TCallback *func = (TCallback *)data;
         (*func)();
     }
 
-    Rc<Timer> timer;
-    Rc<TCallback> callback;
+    Rc<State> state;
 };
 
 CLICK_ENDDECLS
\ No newline at end of file
@@ -1,109 +1,161 @@
 #pragma once
 
 #include <click/config.h>
-#include <click/hashmap.hh>
 #include <click/element.hh>
+#include <click/timestamp.hh>
 #include "CallbackTimer.hh"
+#include "TimingWheel.hh"
 
 CLICK_DECLS
 
 /// Represents a schedule of events which have yet to fire.
+///
+/// Events are stored in a timing wheel with a resolution of one millisecond, so
+/// scheduling and cancelling an event does not allocate a timer of its own. A single
+/// Click timer is kept scheduled at the wheel's next tick.
 template <typename TEvent>
 class EventSchedule final
 {
   public:
+    /// Identifies a scheduled event, so it can be cancelled.
+    typedef typename TimingWheel<TEvent>::handle_type handle_type;
+
     EventSchedule(Element *owner)
-        : owner(owner), id_counter(0), events()
+        : owner(owner), wheel(), timer(this)
     {
     }
 
+    // The schedule's timer refers back to the schedule, so a copy would fire the
+    // original's events.
+    EventSchedule(const EventSchedule &) = delete;
+    EventSchedule &operator=(const EventSchedule &) = delete;
+
     /// Makes the given event fire after the given number of milliseconds.
-    void schedule_after_msec(uint32_t delta_msec, const TEvent &event)
+    handle_type schedule_after_msec(uint32_t delta_msec, const TEvent &event)
+    {
+        uint64_t now_msec = Timestamp::recent_steady().msecval();
+        wheel.synchronize(now_msec);
+        auto handle = wheel.insert(now_msec + delta_msec, event);
+        update_timer();
+        return handle;
+    }
+
+    /// Makes the given event fire at the given steady timestamp. The schedule's
+    /// resolution is one millisecond, so the timestamp is rounded up to the next
+    /// millisecond: events never fire early.
+    handle_type schedule_at_steady(const Timestamp &expiry, const TEvent &event)
     {
-        // First, get rid of all expired events.
-        for (const auto &item : expired_events)
+        uint64_t now_msec = Timestamp::recent_steady().msecval();
+        wheel.synchronize(now_msec);
+        uint64_t expiry_msec = expiry.msecval();
+        if (Timestamp::make_msec(expiry_msec) < expiry)
         {
-            events.erase(item);
+            expiry_msec++;
         }
-        expired_events.clear();
-
-        // Generate an id.
-        auto id = id_counter++;
-        // Create a timer with a callback.
-        CallbackTimer<EventCallback> timer{id, event, this};
-        // Initialize the timer and schedule its expiry.
-        timer.initialize(owner);
-        timer.schedule_after_msec(delta_msec);
-
-        // Add the timer to the list of scheduled events.
-        // (to keep it alive)
-        events.insert(id, timer);
+        auto handle = wheel.insert(expiry_msec, event);
+
+        // The timer only has to move if the new event fires before it does. Otherwise,
+        // the timer reschedules itself once it has run the events that come first.
+        if (!timer.scheduled() || Timestamp::make_msec(expiry_msec) < timer.expiry_steady())
+        {
+            update_timer();
+        }
+        return handle;
     }
 
     /// Makes the given event fire after the given number of deciseconds.
-    void schedule_after_dsec(uint32_t delta_dsec, const TEvent &event)
+    handle_type schedule_after_dsec(uint32_t delta_dsec, const TEvent &event)
+    {
+        return schedule_after_msec(delta_dsec * 100, event);
+    }
+
+    /// Cancels the event with the given handle. A Boolean result tells if the event
+    /// had yet to fire.
+    bool cancel(handle_type handle)
     {
-        schedule_after_msec(delta_dsec * 100, event);
+        return wheel.cancel(handle);
     }
 
     /// Clears this schedule.
     void clear()
     {
-        events.clear();
-        expired_events.clear();
+        wheel.clear();
+        timer.unschedule();
+    }
+
+    /// Gets the number of events that have yet to fire.
+    int size() const
+    {
+        return wheel.size();
+    }
+
+    /// Fires all events that have expired.
+    void run_expired_events()
+    {
+        uint64_t now_msec = Timestamp::recent_steady().msecval();
+
+        // Every event is popped from the wheel before it runs, so events are free to
+        // schedule new events or to clear the schedule.
+        TEvent event;
+        while (wheel.pop_expired(now_msec, event))
+        {
+            event();
+        }
+
+        update_timer();
     }
 
   private:
-    struct EventCallback
+    struct ScheduleCallback
     {
-        EventCallback()
-            : id(), event(), schedule(nullptr)
+        ScheduleCallback()
+            : schedule(nullptr)
         {
         }
-        EventCallback(uint64_t id, const TEvent &event, EventSchedule *schedule)
-            : id(id), event(event), schedule(schedule)
+        ScheduleCallback(EventSchedule *schedule)
+            : schedule(schedule)
         {
         }
 
-        uint64_t id;
-        TEvent event;
         EventSchedule *schedule;
 
         void operator()()
         {
-            if (schedule == nullptr)
+            if (schedule != nullptr)
             {
-                return;
+                schedule->run_expired_events();
             }
+        }
+    };
 
-            // Run the event.
-            event();
+    /// Schedules the timer at the wheel's next tick, or unschedules it if the wheel
+    /// is empty.
+    void update_timer()
+    {
+        uint64_t next_msec;
+        if (!wheel.next_tick(next_msec))
+        {
+            timer.unschedule();
+            return;
+        }
 
-            // Mark the event as expired.
-            schedule->expired_events.push_back(id);
-
-            // NOTE: the event's timer is not removed directly here
-            // because that could have funny consequences.
-            //
-            // Suppose that we did this:
-            //
-            //     events.erase(id);
-            //
-            // Then the callback for that event would be deleted by the hashmap,
-            // i.e., its destructor would be called and the memory would be recycled.
-            // Now keep in mind that this method _is part of_ that callback.
-            // I might be wrong, but I think that destroying an object that still has
-            // an active call frame on the stack is undefined behavior, so not a good
-            // idea.
-            //
-            // To work around this, schedule_after_msec erases expired events afterward.
+        // The timer is only initialized here because elements' timers cannot be
+        // initialized before the element has been configured.
+        if (!timer.initialized())
+        {
+            timer.initialize(owner);
         }
-    };
+
+        auto expiry = Timestamp::make_msec(next_msec);
+        if (!timer.scheduled() || timer.expiry_steady() != expiry)
+        {
+            timer.schedule_at_steady(expiry);
+        }
+    }
 
     Element *owner;
-    uint64_t id_counter;
-    HashMap<uint64_t, CallbackTimer<EventCallback>> events;
-    Vector<uint64_t> expired_events;
+    TimingWheel<TEvent> wheel;
+    CallbackTimer<ScheduleCallback> timer;
 };
 
-CLICK_ENDDECLS
\ No newline at end of file
+CLICK_ENDDECLS
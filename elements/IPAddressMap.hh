@@ -0,0 +1,439 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <clicknet/ip.h>
+#include <new>
+
+CLICK_DECLS
+
+/// A hash map with IPv4 addresses as keys. Its interface is a subset of Click's
+/// 'HashMap<IPAddress, V>', but its layout is tailored to 32-bit keys:
+///
+///   * Entries are stored in open-addressed tables with linear probing. Keys and slot
+///     states live in arrays of their own, so a lookup scans a few adjacent cache
+///     lines instead of chasing a pointer per entry.
+///
+///   * Keys are hashed with a per-map random seed. Multicast addresses often share
+///     their high bits, and an attacker who floods us with reports cannot predict
+///     which addresses collide.
+///
+///   * Growing the map does not rehash all entries at once. Instead, the old table
+///     is kept around and each subsequent insertion or erasure migrates a few of its
+///     entries to the new table. Lookups consult both tables while a migration is
+///     in progress.
+///
+/// Like 'HashMap', inserting or erasing an entry may invalidate pointers to other
+/// entries.
+template <typename V>
+class IPAddressMap final
+{
+    struct Table;
+
+  public:
+    /// An iterator over the entries of an IP address map.
+    template <typename TMap, typename TValue>
+    class basic_iterator
+    {
+      public:
+        basic_iterator(TMap *map, int table, int index)
+            : map(map), table(table), index(index)
+        {
+            settle();
+        }
+
+        /// Gets the key of the entry this iterator points to.
+        IPAddress key() const
+        {
+            return IPAddress(map->tables[table].keys[index]);
+        }
+
+        /// Gets the value of the entry this iterator points to.
+        TValue &value() const
+        {
+            return map->tables[table].values()[index];
+        }
+
+        basic_iterator &operator++()
+        {
+            index++;
+            settle();
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++(*this);
+        }
+
+        bool operator==(const basic_iterator &other) const
+        {
+            return table == other.table && index == other.index;
+        }
+
+        bool operator!=(const basic_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+      private:
+        /// Moves this iterator forward to the next full slot, if it's not at one already.
+        void settle()
+        {
+            while (table < table_count)
+            {
+                const Table &current = map->tables[table];
+                while (index < current.capacity && current.states[index] != slot_full)
+                {
+                    index++;
+                }
+                if (index < current.capacity)
+                {
+                    return;
+                }
+                table++;
+                index = 0;
+            }
+        }
+
+        TMap *map;
+        int table;
+        int index;
+    };
+
+    typedef basic_iterator<IPAddressMap, V> iterator;
+    typedef basic_iterator<const IPAddressMap, const V> const_iterator;
+
+    IPAddressMap()
+        : seed(((uint32_t)click_random() << 16) ^ (uint32_t)click_random()), migration_index(0)
+    {
+    }
+
+    IPAddressMap(const IPAddressMap &) = delete;
+    IPAddressMap &operator=(const IPAddressMap &) = delete;
+
+    ~IPAddressMap()
+    {
+        release(tables[0]);
+        release(tables[1]);
+    }
+
+    /// Gets the number of entries in this map.
+    int size() const
+    {
+        return tables[0].count + tables[1].count;
+    }
+
+    /// Tests if this map is empty.
+    bool empty() const
+    {
+        return size() == 0;
+    }
+
+    /// Gets a pointer to the value for the given key, or null if there is no such value.
+    V *findp(const IPAddress &key)
+    {
+        return const_cast<V *>(static_cast<const IPAddressMap *>(this)->findp(key));
+    }
+
+    /// Gets a pointer to the value for the given key, or null if there is no such value.
+    const V *findp(const IPAddress &key) const
+    {
+        uint32_t key_value = key.addr();
+        uint32_t key_hash = hash(key_value);
+        for (int i = 0; i < table_count; i++)
+        {
+            int index = find_slot(tables[i], key_value, key_hash);
+            if (index >= 0)
+            {
+                return &tables[i].values()[index];
+            }
+        }
+        return nullptr;
+    }
+
+    /// Maps the given key to the given value. A Boolean result tells if the key was
+    /// new to the map. If it was not, then its value is replaced.
+    bool insert(const IPAddress &key, const V &value)
+    {
+        migrate_step();
+
+        V *existing_value_ptr = findp(key);
+        if (existing_value_ptr != nullptr)
+        {
+            *existing_value_ptr = value;
+            return false;
+        }
+
+        reserve_slot();
+        uint32_t key_value = key.addr();
+        insert_new(tables[0], key_value, hash(key_value), value);
+        return true;
+    }
+
+    /// Erases the entry for the given key. A Boolean result tells if the map had an
+    /// entry for the key.
+    bool erase(const IPAddress &key)
+    {
+        migrate_step();
+
+        uint32_t key_value = key.addr();
+        uint32_t key_hash = hash(key_value);
+        for (int i = 0; i < table_count; i++)
+        {
+            int index = find_slot(tables[i], key_value, key_hash);
+            if (index >= 0)
+            {
+                erase_slot(tables[i], index);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// Removes all entries from this map.
+    void clear()
+    {
+        release(tables[0]);
+        release(tables[1]);
+        migration_index = 0;
+    }
+
+    iterator begin() { return iterator(this, 0, 0); }
+    iterator end() { return iterator(this, table_count, 0); }
+    const_iterator begin() const { return const_iterator(this, 0, 0); }
+    const_iterator end() const { return const_iterator(this, table_count, 0); }
+
+  private:
+    static const uint8_t slot_empty = 0;
+    static const uint8_t slot_full = 1;
+    static const uint8_t slot_deleted = 2;
+
+    /// The number of tables: the current table and the table that is being migrated.
+    static const int table_count = 2;
+
+    /// The smallest number of slots in a table.
+    static const int min_capacity = 8;
+
+    /// The number of old entries that are migrated on every insertion or erasure.
+    static const int migration_batch_size = 8;
+
+    struct Table
+    {
+        Table()
+            : keys(nullptr), states(nullptr), storage(nullptr), capacity(0), count(0), tombstones(0)
+        {
+        }
+
+        V *values() const
+        {
+            return reinterpret_cast<V *>(storage);
+        }
+
+        uint32_t *keys;
+        uint8_t *states;
+        unsigned char *storage;
+        /// The number of slots in the table. This is always zero or a power of two.
+        int capacity;
+        /// The number of full slots.
+        int count;
+        /// The number of deleted slots.
+        int tombstones;
+    };
+
+    /// Hashes a key. This is the 32-bit finalizer from MurmurHash3, applied to the key
+    /// mixed with this map's seed.
+    uint32_t hash(uint32_t key) const
+    {
+        uint32_t result = key ^ seed;
+        result ^= result >> 16;
+        result *= 0x85ebca6b;
+        result ^= result >> 13;
+        result *= 0xc2b2ae35;
+        result ^= result >> 16;
+        return result;
+    }
+
+    /// Finds the slot that holds the given key in the given table, or returns -1.
+    static int find_slot(const Table &table, uint32_t key, uint32_t key_hash)
+    {
+        if (table.count == 0)
+        {
+            return -1;
+        }
+
+        uint32_t mask = table.capacity - 1;
+        for (uint32_t index = key_hash & mask;; index = (index + 1) & mask)
+        {
+            uint8_t state = table.states[index];
+            if (state == slot_empty)
+            {
+                return -1;
+            }
+            else if (state == slot_full && table.keys[index] == key)
+            {
+                return index;
+            }
+        }
+    }
+
+    /// Inserts a key that is not in the table yet. The table must have a free slot.
+    static void insert_new(Table &table, uint32_t key, uint32_t key_hash, const V &value)
+    {
+        uint32_t mask = table.capacity - 1;
+        uint32_t index = key_hash & mask;
+        while (table.states[index] == slot_full)
+        {
+            index = (index + 1) & mask;
+        }
+
+        if (table.states[index] == slot_deleted)
+        {
+            table.tombstones--;
+        }
+        table.keys[index] = key;
+        table.states[index] = slot_full;
+        new (&table.values()[index]) V(value);
+        table.count++;
+    }
+
+    static void erase_slot(Table &table, int index)
+    {
+        table.values()[index].~V();
+        table.states[index] = slot_deleted;
+        table.count--;
+        table.tombstones++;
+    }
+
+    static void allocate(Table &table, int capacity)
+    {
+        table.keys = new uint32_t[capacity];
+        table.states = new uint8_t[capacity];
+        table.storage = new unsigned char[sizeof(V) * capacity];
+        memset(table.states, slot_empty, capacity);
+        table.capacity = capacity;
+        table.count = 0;
+        table.tombstones = 0;
+    }
+
+    static void release(Table &table)
+    {
+        for (int i = 0; i < table.capacity; i++)
+        {
+            if (table.states[i] == slot_full)
+            {
+                table.values()[i].~V();
+            }
+        }
+        delete[] table.keys;
+        delete[] table.states;
+        delete[] table.storage;
+        table = Table();
+    }
+
+    /// Makes sure that the current table can take one more entry without exceeding a
+    /// load factor of 3/4. Entries that are still in the old table count towards the
+    /// current table's load, because they will end up there.
+    void reserve_slot()
+    {
+        Table &current = tables[0];
+        int load = current.count + current.tombstones + tables[1].count + 1;
+        if (load * 4 <= current.capacity * 3)
+        {
+            return;
+        }
+
+        // Only one migration can be in progress at a time. Finishing the old migration
+        // does not overfill the current table, since the old table's entries were
+        // already accounted for.
+        finish_migration();
+
+        // Pick a capacity that puts the new table's load factor at or below 1/2.
+        int capacity = min_capacity;
+        while ((current.count + 1) * 2 > capacity)
+        {
+            capacity *= 2;
+        }
+
+        tables[1] = current;
+        allocate(tables[0], capacity);
+        migration_index = 0;
+        if (tables[1].count == 0)
+        {
+            release(tables[1]);
+        }
+    }
+
+    /// Migrates a batch of entries from the old table to the current table.
+    void migrate_step()
+    {
+        Table &old = tables[1];
+        if (old.capacity == 0)
+        {
+            return;
+        }
+
+        // Visit a bounded number of slots, so sparse old tables don't make a single
+        // step expensive.
+        int migrated = 0;
+        int visited = 0;
+        while (migration_index < old.capacity
+               && migrated < migration_batch_size
+               && visited < 4 * migration_batch_size)
+        {
+            if (migrate_slot(migration_index))
+            {
+                migrated++;
+            }
+            migration_index++;
+            visited++;
+        }
+
+        if (migration_index == old.capacity || old.count == 0)
+        {
+            release(old);
+            migration_index = 0;
+        }
+    }
+
+    /// Migrates all remaining entries from the old table to the current table.
+    void finish_migration()
+    {
+        Table &old = tables[1];
+        for (; migration_index < old.capacity; migration_index++)
+        {
+            migrate_slot(migration_index);
+        }
+        release(old);
+        migration_index = 0;
+    }
+
+    /// Moves the entry in the given slot of the old table, if any, to the current
+    /// table. The old slot becomes a tombstone so probe sequences for the old table's
+    /// other entries remain intact.
+    bool migrate_slot(int index)
+    {
+        Table &old = tables[1];
+        if (old.states[index] != slot_full)
+        {
+            return false;
+        }
+
+        uint32_t key = old.keys[index];
+        insert_new(tables[0], key, hash(key), old.values()[index]);
+        erase_slot(old, index);
+        return true;
+    }
+
+    /// The seed for the hash function.
+    uint32_t seed;
+
+    /// The current table and the old table. The old table is empty unless a
+    /// migration is in progress.
+    Table tables[table_count];
+
+    /// The index of the next slot in the old table to migrate.
+    int migration_index;
+};
+
+CLICK_ENDDECLS
@@ -0,0 +1,406 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <clicknet/ip.h>
+
+CLICK_DECLS
+
+/// A map with IPv4 addresses as keys that stores runs of consecutive addresses with
+/// equal values as a single range. Memory use and lookup cost therefore depend on the
+/// number of distinct runs, not on the number of addresses, which suits groups that
+/// are joined in blocks.
+///
+///   * Ranges are stored as a structure of arrays, sorted by address: the first
+///     address of every range, the last address of every range and the index of the
+///     range's value. A lookup is a binary search over the array of first addresses.
+///
+///   * Values live in slots of their own, which several ranges can share. Splitting a
+///     range to change a single address therefore does not copy its value. Slots
+///     that are no longer used are recycled, along with whatever storage their
+///     values own.
+///
+///   * Changes split ranges but do not merge them again right away. Adjacent ranges
+///     with equal values are coalesced in a single pass once the number of ranges
+///     has doubled since the previous pass, so a block that is changed one address
+///     at a time costs amortized constant time per change to coalesce.
+///
+/// Values must be comparable with '=='. Like 'IPAddressMap', changing the map may
+/// invalidate pointers to its values.
+template <typename V>
+class IPAddressRangeMap final
+{
+  public:
+    /// An iterator over the addresses in a range map and their values. Addresses
+    /// are visited in ascending order.
+    class const_iterator
+    {
+      public:
+        const_iterator(const IPAddressRangeMap *map, int range, uint32_t offset)
+            : map(map), range(range), offset(offset)
+        {
+        }
+
+        /// Gets the address this iterator points to.
+        IPAddress key() const
+        {
+            return IPAddress(htonl(map->firsts[range] + offset));
+        }
+
+        /// Gets the value of the address this iterator points to.
+        const V &value() const
+        {
+            return map->slot_values[map->slot_indices[range]];
+        }
+
+        const_iterator &operator++()
+        {
+            if (map->firsts[range] + offset == map->lasts[range])
+            {
+                range++;
+                offset = 0;
+            }
+            else
+            {
+                offset++;
+            }
+            return *this;
+        }
+
+        void operator++(int)
+        {
+            ++(*this);
+        }
+
+        bool operator==(const const_iterator &other) const
+        {
+            return range == other.range && offset == other.offset;
+        }
+
+        bool operator!=(const const_iterator &other) const
+        {
+            return !(*this == other);
+        }
+
+      private:
+        const IPAddressRangeMap *map;
+        int range;
+        uint32_t offset;
+    };
+
+    typedef const_iterator iterator;
+
+    IPAddressRangeMap()
+        : address_count(0), coalesce_limit(min_coalesce_limit)
+    {
+    }
+
+    IPAddressRangeMap(const IPAddressRangeMap &) = delete;
+    IPAddressRangeMap &operator=(const IPAddressRangeMap &) = delete;
+
+    /// Gets the number of addresses in this map.
+    int size() const
+    {
+        return address_count;
+    }
+
+    /// Tests if this map is empty.
+    bool empty() const
+    {
+        return firsts.empty();
+    }
+
+    /// Gets the number of ranges that this map's addresses are stored as.
+    int range_count() const
+    {
+        return firsts.size();
+    }
+
+    /// Gets a pointer to the value for the given key, or null if there is no such value.
+    const V *findp(const IPAddress &key) const
+    {
+        int range = find_range(ntohl(key.addr()));
+        return range < 0 ? nullptr : &slot_values[slot_indices[range]];
+    }
+
+    /// Gives the given key a value of its own and returns a pointer to it. The key
+    /// is added to the map if it is not in the map yet.
+    ///
+    /// The value that the pointer refers to is unspecified: it is either the key's
+    /// current value or a recycled one. The caller must assign all of it.
+    V *claim(const IPAddress &key)
+    {
+        // Coalesce before the change rather than after: the caller has yet to assign
+        // the value that is returned, so it cannot be compared to its neighbors.
+        coalesce_if_fragmented();
+
+        uint32_t key_value = ntohl(key.addr());
+        int range = find_range(key_value);
+        int slot;
+        if (range < 0)
+        {
+            range = upper_bound(key_value);
+            slot = acquire_slot();
+            insert_range(range, key_value, key_value, slot);
+            address_count++;
+        }
+        else
+        {
+            range = isolate(range, key_value);
+            slot = slot_indices[range];
+            if (slot_refs[slot] > 1)
+            {
+                // Other ranges still use the old value, so give the key a slot of its
+                // own.
+                release_slot(slot);
+                slot = acquire_slot();
+                slot_indices[range] = slot;
+            }
+        }
+
+        return &slot_values[slot];
+    }
+
+    /// Gives the given key the value of another key, which must be in the map. The
+    /// key is added to the map if it is not in the map yet. The two keys then share a
+    /// value slot, so nothing is copied and coalescing them again takes no value
+    /// comparison.
+    ///
+    /// If the key directly follows the other key's range, then that range is simply
+    /// extended, so changing a block one address after the other does not split any
+    /// ranges at all.
+    void share(const IPAddress &key, const IPAddress &other_key)
+    {
+        coalesce_if_fragmented();
+
+        int other_range = find_range(ntohl(other_key.addr()));
+        assert(other_range >= 0);
+        int slot = slot_indices[other_range];
+
+        uint32_t key_value = ntohl(key.addr());
+        int range = find_range(key_value);
+        if (lasts[other_range] + 1 == key_value && (range < 0 || firsts[range] == key_value))
+        {
+            lasts[other_range] = key_value;
+            if (range < 0)
+            {
+                address_count++;
+            }
+            else if (lasts[range] == key_value)
+            {
+                remove_range(range);
+            }
+            else
+            {
+                firsts[range]++;
+            }
+            return;
+        }
+
+        slot_refs[slot]++;
+        if (range < 0)
+        {
+            insert_range(upper_bound(key_value), key_value, key_value, slot);
+            address_count++;
+        }
+        else
+        {
+            range = isolate(range, key_value);
+            release_slot(slot_indices[range]);
+            slot_indices[range] = slot;
+        }
+    }
+
+    /// Erases the entry for the given key. A Boolean result tells if the map had an
+    /// entry for the key.
+    bool erase(const IPAddress &key)
+    {
+        coalesce_if_fragmented();
+
+        uint32_t key_value = ntohl(key.addr());
+        int range = find_range(key_value);
+        if (range < 0)
+        {
+            return false;
+        }
+
+        remove_range(isolate(range, key_value));
+        address_count--;
+        return true;
+    }
+
+    /// Removes all entries from this map.
+    void clear()
+    {
+        firsts.clear();
+        lasts.clear();
+        slot_indices.clear();
+        slot_values.clear();
+        slot_refs.clear();
+        free_slots.clear();
+        address_count = 0;
+        coalesce_limit = min_coalesce_limit;
+    }
+
+    /// Merges all adjacent ranges with equal values. This happens automatically as
+    /// ranges are split, so it only needs to be called to compact the map right away.
+    void coalesce()
+    {
+        int count = 0;
+        for (int i = 0; i < firsts.size(); i++)
+        {
+            if (count > 0 && lasts[count - 1] + 1 == firsts[i] &&
+                (slot_indices[count - 1] == slot_indices[i] ||
+                 slot_values[slot_indices[count - 1]] == slot_values[slot_indices[i]]))
+            {
+                lasts[count - 1] = lasts[i];
+                release_slot(slot_indices[i]);
+                continue;
+            }
+
+            firsts[count] = firsts[i];
+            lasts[count] = lasts[i];
+            slot_indices[count] = slot_indices[i];
+            count++;
+        }
+        firsts.resize(count);
+        lasts.resize(count);
+        slot_indices.resize(count);
+        coalesce_limit = 2 * count < min_coalesce_limit ? min_coalesce_limit : 2 * count;
+    }
+
+    const_iterator begin() const { return const_iterator(this, 0, 0); }
+    const_iterator end() const { return const_iterator(this, firsts.size(), 0); }
+
+  private:
+    /// The number of ranges below which ranges are never coalesced.
+    static const int min_coalesce_limit = 16;
+
+    /// Finds the index of the first range that starts after the given address.
+    int upper_bound(uint32_t key) const
+    {
+        int first = 0;
+        int count = firsts.size();
+        while (count > 0)
+        {
+            int step = count / 2;
+            if (firsts[first + step] <= key)
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+            {
+                count = step;
+            }
+        }
+        return first;
+    }
+
+    /// Finds the index of the range that contains the given address, or returns -1.
+    int find_range(uint32_t key) const
+    {
+        int range = upper_bound(key) - 1;
+        return range >= 0 && key <= lasts[range] ? range : -1;
+    }
+
+    /// Splits a range such that the given address, which it contains, gets a range
+    /// of its own, and returns the index of that range. The pieces share the original
+    /// range's value slot.
+    int isolate(int range, uint32_t key)
+    {
+        uint32_t first = firsts[range];
+        uint32_t last = lasts[range];
+        int slot = slot_indices[range];
+        if (key != last)
+        {
+            insert_range(range + 1, key + 1, last, slot);
+            slot_refs[slot]++;
+            lasts[range] = key;
+        }
+        if (key != first)
+        {
+            insert_range(range + 1, key, key, slot);
+            slot_refs[slot]++;
+            lasts[range] = key - 1;
+            range++;
+        }
+        return range;
+    }
+
+    void insert_range(int range, uint32_t first, uint32_t last, int slot)
+    {
+        firsts.insert(firsts.begin() + range, first);
+        lasts.insert(lasts.begin() + range, last);
+        slot_indices.insert(slot_indices.begin() + range, slot);
+    }
+
+    /// Removes a range and drops its reference to its value slot. This does not
+    /// update the address count.
+    void remove_range(int range)
+    {
+        release_slot(slot_indices[range]);
+        firsts.erase(firsts.begin() + range);
+        lasts.erase(lasts.begin() + range);
+        slot_indices.erase(slot_indices.begin() + range);
+    }
+
+    /// Takes a value slot, recycling one if possible, and returns its index.
+    int acquire_slot()
+    {
+        int slot;
+        if (free_slots.empty())
+        {
+            slot = slot_values.size();
+            slot_values.push_back(V());
+            slot_refs.push_back(0);
+        }
+        else
+        {
+            slot = free_slots.back();
+            free_slots.pop_back();
+        }
+        slot_refs[slot] = 1;
+        return slot;
+    }
+
+    /// Drops a range's reference to a value slot.
+    void release_slot(int slot)
+    {
+        if (--slot_refs[slot] == 0)
+        {
+            free_slots.push_back(slot);
+        }
+    }
+
+    /// Coalesces ranges if enough ranges have been split off since the last time.
+    void coalesce_if_fragmented()
+    {
+        if (firsts.size() > coalesce_limit)
+        {
+            coalesce();
+        }
+    }
+
+    /// The first address of every range, in host byte order and ascending order.
+    Vector<uint32_t> firsts;
+    /// The last address of every range, in host byte order.
+    Vector<uint32_t> lasts;
+    /// The index of every range's value slot.
+    Vector<int> slot_indices;
+
+    /// The value slots.
+    Vector<V> slot_values;
+    /// The number of ranges that refer to every value slot.
+    Vector<int> slot_refs;
+    /// The indices of unused value slots.
+    Vector<int> free_slots;
+
+    /// The number of addresses in the map.
+    int address_count;
+    /// The number of ranges above which ranges are coalesced.
+    int coalesce_limit;
+};
+
+CLICK_ENDDECLS
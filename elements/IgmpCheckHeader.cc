@@ -27,14 +27,14 @@ int IgmpCheckHeader::configure(Vector<String> &conf, ErrorHandler *errh)
 
 void IgmpCheckHeader::push(int port, Packet *packet)
 {
-    WritablePacket *result = packet->uniqueify();
-    if (get_igmp_checksum(result->data()) == compute_igmp_checksum(result->data(), result->length()))
+    // The checksum is verified in place, so there's no need for a writable packet.
+    if (verify_igmp_checksum(packet->data(), packet->length()))
     {
-        output(0).push(result);
+        output(0).push(packet);
     }
     else
     {
-        output(1).push(result);
+        output(1).push(packet);
     }
 }
 
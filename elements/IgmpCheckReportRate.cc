@@ -0,0 +1,66 @@
+#include "IgmpCheckReportRate.hh"
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <clicknet/ip.h>
+#include "IgmpMessage.hh"
+
+CLICK_DECLS
+IgmpCheckReportRate::IgmpCheckReportRate()
+{
+}
+
+IgmpCheckReportRate::~IgmpCheckReportRate()
+{
+}
+
+int IgmpCheckReportRate::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    unsigned int rate = 0;
+    unsigned int burst = 0;
+    int sources = IgmpReportRateLimiter::default_max_sources;
+    if (cp_va_kparse(conf, this, errh,
+                     "RATE", cpkM, cpUnsigned, &rate,
+                     "BURST", cpkN, cpUnsigned, &burst,
+                     "SOURCES", cpkN, cpInteger, &sources,
+                     cpEnd) < 0)
+        return -1;
+
+    return limiter.configure(rate, burst, sources, errh);
+}
+
+void IgmpCheckReportRate::push(int, Packet *packet)
+{
+    if (!is_igmp_v3_membership_report(packet->data())
+        || limiter.admit(packet->ip_header()->ip_src, Timestamp::recent_steady().msecval()))
+    {
+        output(0).push(packet);
+    }
+    else if (noutputs() > 1)
+    {
+        output(1).push(packet);
+    }
+    else
+    {
+        packet->kill();
+    }
+}
+
+String IgmpCheckReportRate::report_drops(Element *e, void *thunk)
+{
+    IgmpCheckReportRate *self = (IgmpCheckReportRate *)e;
+    if (thunk == 0)
+        return self->limiter.drops_to_string();
+    else
+        return String(self->limiter.get_total_drops());
+}
+
+void IgmpCheckReportRate::add_handlers()
+{
+    add_read_handler("report_drops", &report_drops, (void *)0);
+    add_read_handler("total_report_drops", &report_drops, (void *)1);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IgmpCheckReportRate)
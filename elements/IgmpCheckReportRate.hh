@@ -0,0 +1,66 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/element.hh>
+#include "IgmpReportRateLimiter.hh"
+
+CLICK_DECLS
+
+class IgmpCheckReportRate;
+
+/// Limits the rate at which membership reports are accepted from each source
+/// address, like the REPORT_RATE option of 'IgmpRouter', but as an element of its
+/// own. That allows reports to be limited before they are queued: a source that is
+/// over its limit then cannot take up queue space that other sources need.
+///
+/// Reports are checked before they are parsed. Other IGMP messages are never
+/// limited.
+class IgmpCheckReportRate : public Element
+{
+  public:
+    IgmpCheckReportRate();
+    ~IgmpCheckReportRate();
+
+    // Description of ports:
+    //
+    //     Input:
+    //         0. IGMP packets, with their IP headers stripped. Their IP header
+    //            annotations must still be set.
+    //
+    //     Output:
+    //         0. IGMP packets that are within their source's rate limit.
+    //         1. Membership reports that are over their source's rate limit.
+    //            Dropped if not connected.
+
+    // Configuration keywords:
+    //
+    //     RATE: the number of membership reports per second that are accepted from
+    //         each source address. Mandatory. Zero means that there is no limit.
+    //
+    //     BURST: the number of membership reports that a source may send at once
+    //         before RATE kicks in. Defaults to RATE.
+    //
+    //     SOURCES: the largest number of sources to keep track of. Beyond that,
+    //         the sources that reported least recently are forgotten, and start
+    //         over with a full burst. Defaults to 4096.
+    //
+    // The report_drops handler lists the number of reports that were dropped per
+    // source, and the total_report_drops handler counts them over all sources.
+
+    const char *class_name() const { return "IgmpCheckReportRate"; }
+    const char *port_count() const { return "1/1-2"; }
+    const char *processing() const { return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+
+    static String report_drops(Element *e, void *thunk);
+
+    void add_handlers();
+
+    void push(int port, Packet *packet);
+
+  private:
+    IgmpReportRateLimiter limiter;
+};
+
+CLICK_ENDDECLS
@@ -0,0 +1,158 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+CLICK_DECLS
+
+// The Internet checksum is the one's complement of the one's complement sum of a
+// message's 16-bit words. A one's complement sum can be computed by adding words
+// into a wide accumulator and folding the carries back in at the end. It also does
+// not depend on byte order, as long as the result is stored in the order in which
+// it was computed. So the functions below add up words in the host's byte order and
+// use whichever vector instructions the compiler is allowed to emit.
+
+/// Adds the 16-bit words in the given buffer to a wide accumulator, using scalar
+/// instructions. A trailing odd byte is padded with a zero byte.
+inline uint64_t igmp_checksum_add_scalar(uint64_t sum, const unsigned char *data, size_t size)
+{
+    size_t i = 0;
+    for (; i + 8 <= size; i += 8)
+    {
+        uint32_t first, second;
+        memcpy(&first, data + i, sizeof(uint32_t));
+        memcpy(&second, data + i + 4, sizeof(uint32_t));
+        sum += (uint64_t)first + second;
+    }
+    for (; i + 2 <= size; i += 2)
+    {
+        uint16_t word;
+        memcpy(&word, data + i, sizeof(uint16_t));
+        sum += word;
+    }
+    if (i < size)
+    {
+        uint16_t word = 0;
+        memcpy(&word, data + i, 1);
+        sum += word;
+    }
+    return sum;
+}
+
+#if defined(__AVX2__)
+
+/// Adds the 16-bit words in the given buffer to a wide accumulator, 32 bytes at a
+/// time.
+inline uint64_t igmp_checksum_add_vector(uint64_t sum, const unsigned char *data, size_t size)
+{
+    // Words are widened to 32-bit lanes. Each lane can absorb 65537 words before it
+    // overflows, so the lanes are flushed to the scalar accumulator well before that.
+    const size_t block_size = 32;
+    const size_t blocks_per_flush = 8192;
+    size_t i = 0;
+    while (i + block_size <= size)
+    {
+        __m256i lanes = _mm256_setzero_si256();
+        for (size_t n = 0; n < blocks_per_flush && i + block_size <= size; n++, i += block_size)
+        {
+            __m256i words = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(data + i));
+            lanes = _mm256_add_epi32(lanes, _mm256_cvtepu16_epi32(_mm256_castsi256_si128(words)));
+            lanes = _mm256_add_epi32(lanes, _mm256_cvtepu16_epi32(_mm256_extracti128_si256(words, 1)));
+        }
+
+        uint32_t partial_sums[8];
+        _mm256_storeu_si256(reinterpret_cast<__m256i *>(partial_sums), lanes);
+        for (int lane = 0; lane < 8; lane++)
+        {
+            sum += partial_sums[lane];
+        }
+    }
+    return igmp_checksum_add_scalar(sum, data + i, size - i);
+}
+
+#elif defined(__SSE2__)
+
+/// Adds the 16-bit words in the given buffer to a wide accumulator, 16 bytes at a
+/// time.
+inline uint64_t igmp_checksum_add_vector(uint64_t sum, const unsigned char *data, size_t size)
+{
+    // Words are widened to 32-bit lanes. Each lane can absorb 65537 words before it
+    // overflows, so the lanes are flushed to the scalar accumulator well before that.
+    const size_t block_size = 16;
+    const size_t blocks_per_flush = 16384;
+    const __m128i zero = _mm_setzero_si128();
+    size_t i = 0;
+    while (i + block_size <= size)
+    {
+        __m128i lanes = _mm_setzero_si128();
+        for (size_t n = 0; n < blocks_per_flush && i + block_size <= size; n++, i += block_size)
+        {
+            __m128i words = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+            lanes = _mm_add_epi32(lanes, _mm_unpacklo_epi16(words, zero));
+            lanes = _mm_add_epi32(lanes, _mm_unpackhi_epi16(words, zero));
+        }
+
+        uint32_t partial_sums[4];
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(partial_sums), lanes);
+        for (int lane = 0; lane < 4; lane++)
+        {
+            sum += partial_sums[lane];
+        }
+    }
+    return igmp_checksum_add_scalar(sum, data + i, size - i);
+}
+
+#else
+
+/// Adds the 16-bit words in the given buffer to a wide accumulator. No vector
+/// instructions are available, so this uses the scalar kernel.
+inline uint64_t igmp_checksum_add_vector(uint64_t sum, const unsigned char *data, size_t size)
+{
+    return igmp_checksum_add_scalar(sum, data, size);
+}
+
+#endif
+
+/// Folds a wide one's complement accumulator into a 16-bit one's complement sum.
+inline uint16_t igmp_checksum_fold(uint64_t sum)
+{
+    while (sum >> 16)
+    {
+        sum = (sum & 0xFFFF) + (sum >> 16);
+    }
+    return (uint16_t)sum;
+}
+
+/// Computes the 16-bit one's complement sum of the given buffer, in the host's
+/// byte order.
+inline uint16_t igmp_checksum_sum(const unsigned char *data, size_t size)
+{
+    return igmp_checksum_fold(igmp_checksum_add_vector(0, data, size));
+}
+
+/// Tests if the buffer's one's complement sum indicates a correct checksum. A
+/// message that contains its own, correct checksum sums to 0xFFFF, so there is no
+/// need to clear or copy the checksum field to verify it.
+inline bool igmp_checksum_verify(const unsigned char *data, size_t size)
+{
+    return igmp_checksum_sum(data, size) == 0xFFFF;
+}
+
+/// Computes the checksum for a buffer as if the 16-bit word at the given offset,
+/// which holds the current checksum, were zero. The word is folded out of the sum
+/// arithmetically: adding its one's complement subtracts it.
+inline uint16_t igmp_checksum_compute(const unsigned char *data, size_t size, size_t checksum_offset)
+{
+    uint16_t checksum;
+    memcpy(&checksum, data + checksum_offset, sizeof(uint16_t));
+    uint64_t sum = igmp_checksum_add_vector(0, data, size);
+    sum += (uint16_t)~checksum;
+    return ~igmp_checksum_fold(sum);
+}
+
+CLICK_ENDDECLS
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/timestamp.hh>
+#include <click/vector.hh>
+#include <clicknet/ip.h>
+
+CLICK_DECLS
+
+/// A direct-mapped cache of forwarding decisions for (source, group) pairs.
+///
+/// Every entry is tagged with the generation of the state it was derived from. The
+/// owner of that state bumps its generation whenever a decision may change, which
+/// invalidates all entries at once without touching them. Decisions that rely on a
+/// source timer can also carry an expiry, after which they are stale as well.
+///
+/// A lookup hashes the pair to a single slot, so a hit costs one probe and a
+/// conflicting pair simply evicts the previous entry.
+template <typename TDecision>
+class IgmpForwardingCache final
+{
+  public:
+    /// Creates a cache with the given number of entries, which is rounded up to a
+    /// power of two.
+    IgmpForwardingCache(int size = 256)
+        : seed(((uint32_t)click_random() << 16) ^ (uint32_t)click_random())
+    {
+        int capacity = 1;
+        while (capacity < size)
+        {
+            capacity *= 2;
+        }
+        entries.resize(capacity, Entry());
+        mask = capacity - 1;
+    }
+
+    /// Looks up the decision for the given pair. Returns null if the cache does not
+    /// contain a decision for the pair that is valid for the given generation and
+    /// time.
+    const TDecision *lookup(
+        const IPAddress &multicast_address,
+        const IPAddress &source_address,
+        uint64_t generation,
+        const Timestamp &now) const
+    {
+        const Entry &entry = entries[get_index(multicast_address, source_address)];
+        if (entry.generation != generation
+            || entry.multicast_address != multicast_address.addr()
+            || entry.source_address != source_address.addr()
+            || (entry.has_expiry && entry.expiry <= now))
+        {
+            return nullptr;
+        }
+        return &entry.decision;
+    }
+
+    /// Stores the decision for the given pair. The decision is valid until the
+    /// generation changes or, if 'expiry' is nonzero, until 'expiry'.
+    void store(
+        const IPAddress &multicast_address,
+        const IPAddress &source_address,
+        uint64_t generation,
+        const Timestamp &expiry,
+        const TDecision &decision)
+    {
+        Entry &entry = entries[get_index(multicast_address, source_address)];
+        entry.multicast_address = multicast_address.addr();
+        entry.source_address = source_address.addr();
+        entry.generation = generation;
+        entry.has_expiry = expiry != Timestamp();
+        entry.expiry = expiry;
+        entry.decision = decision;
+    }
+
+    /// Gets the number of entries in this cache.
+    int size() const
+    {
+        return entries.size();
+    }
+
+  private:
+    struct Entry
+    {
+        Entry()
+            : multicast_address(0), source_address(0), generation(0), has_expiry(false), expiry(), decision()
+        {
+        }
+
+        uint32_t multicast_address;
+        uint32_t source_address;
+        /// The generation of the state the decision was derived from. Generation zero
+        /// marks an unused entry.
+        uint64_t generation;
+        bool has_expiry;
+        Timestamp expiry;
+        TDecision decision;
+    };
+
+    int get_index(const IPAddress &multicast_address, const IPAddress &source_address) const
+    {
+        uint32_t result = multicast_address.addr() ^ seed;
+        result = (result ^ (result >> 16)) * 0x85ebca6b;
+        result ^= source_address.addr();
+        result = (result ^ (result >> 13)) * 0xc2b2ae35;
+        result ^= result >> 16;
+        return result & mask;
+    }
+
+    uint32_t seed;
+    uint32_t mask;
+    Vector<Entry> entries;
+};
+
+CLICK_ENDDECLS
@@ -9,6 +9,7 @@
 #include <clicknet/udp.h>
 #include "IgmpMessage.hh"
 #include "IgmpMessageManip.hh"
+#include "IgmpMessageView.hh"
 #include "IgmpMemberFilter.hh"
 
 CLICK_DECLS
@@ -157,21 +158,17 @@ IgmpV3MembershipReport IgmpGroupMember::pop_state_changed_report()
     //       TO_IN    All in the current interface state that must be forwarded
     //       TO_EX    All in the current interface state that must be blocked
 
+    // Groups that no longer have a record have been left, i.e., they are in
+    // INCLUDE({}) mode.
+    const IgmpFilterRecord leave_record = create_igmp_leave_record();
+
     Vector<IPAddress> dead_addresses;
     IgmpV3MembershipReport report;
+    report.group_records.reserve(state_change_transmission_counts.size());
     for (auto iterator = state_change_transmission_counts.begin(); iterator != state_change_transmission_counts.end(); iterator++)
     {
         auto record_ptr = filter.get_record_or_null(iterator.key());
-        IgmpFilterRecord record;
-        if (record_ptr == nullptr)
-        {
-            record.filter_mode = IgmpFilterMode::Include;
-        }
-        else
-        {
-            record = *record_ptr;
-        }
-        report.group_records.push_back(IgmpV3GroupRecord(iterator.key(), record, true));
+        report.add_group_record(iterator.key(), record_ptr == nullptr ? leave_record : *record_ptr, true);
 
         auto &val = iterator.value();
         if (--val <= 0)
@@ -273,13 +270,21 @@ void IgmpGroupMember::push(int port, Packet *packet)
         assert(port == 1);
         if (is_igmp_membership_query(packet->data()))
         {
-            auto data_ptr = packet->data();
-            accept_query(IgmpMembershipQuery::read(data_ptr));
+            IgmpMembershipQueryView query(packet->data(), packet->length());
+            if (query.valid())
+            {
+                accept_query(query);
+            }
+            else
+            {
+                click_chatter("Dropping truncated IGMP membership query at group member");
+            }
         }
+        packet->kill();
     }
 }
 
-void IgmpGroupMember::accept_query(const IgmpMembershipQuery &query)
+void IgmpGroupMember::accept_query(const IgmpMembershipQueryView &query)
 {
     // The spec dictates the following:
     //
@@ -330,7 +335,7 @@ void IgmpGroupMember::accept_query(const IgmpMembershipQuery &query)
         general_response_timer.initialize(this);
     }
 
-    uint32_t response_delay = click_random(1, query.max_resp_time - 1);
+    uint32_t response_delay = click_random(1, query.get_max_resp_time() - 1);
     if (general_response_timer.scheduled() && general_response_timer.remaining_time_dsec() <= response_delay)
     {
         // Case #1. Do nothing.
@@ -343,18 +348,18 @@ void IgmpGroupMember::accept_query(const IgmpMembershipQuery &query)
         return;
     }
 
-    auto response_timer_ptr = group_response_timers.findp(query.group_address);
+    auto response_timer_ptr = group_response_timers.findp(query.get_group_address());
     if (response_timer_ptr == nullptr)
     {
         IgmpGroupQueryResponse response;
         response.elem = this;
-        response.group_address = query.group_address;
-        group_response_timers.insert(query.group_address, response);
-        response_timer_ptr = group_response_timers.findp(query.group_address);
+        response.group_address = query.get_group_address();
+        group_response_timers.insert(query.get_group_address(), response);
+        response_timer_ptr = group_response_timers.findp(query.get_group_address());
         assert(response_timer_ptr != nullptr);
         response_timer_ptr->initialize(this);
     }
-    if (!response_timer_ptr->scheduled() && response_timer_ptr->remaining_time_dsec() <= response_delay && query.source_addresses.size() == 0)
+    if (!response_timer_ptr->scheduled() && response_timer_ptr->remaining_time_dsec() <= response_delay && query.get_number_of_sources() == 0)
     {
         // Cases #3 and #4. Schedule a group-specific query, but only if that speeds
         // up our response.
@@ -387,7 +392,7 @@ void IgmpGroupMember::IgmpGeneralQueryResponse::operator()() const
     IgmpV3MembershipReport report;
     for (auto iterator = elem->filter.begin(); iterator != elem->filter.end(); iterator++)
     {
-        report.group_records.push_back(IgmpV3GroupRecord(iterator.key(), iterator.value(), false));
+        report.add_group_record(iterator.key(), iterator.value(), false);
     }
 
     // Transmit the report.
@@ -424,7 +429,7 @@ void IgmpGroupMember::IgmpGroupQueryResponse::operator()() const
         return;
     }
 
-    report.group_records.push_back(IgmpV3GroupRecord(group_address, *record_ptr, false));
+    report.add_group_record(group_address, *record_ptr, false);
 
     // And transmit it.
     elem->transmit_membership_report(report);
@@ -2,10 +2,11 @@
 
 #include <click/config.h>
 #include <click/element.hh>
-#include <click/hashmap.hh>
 #include "CallbackTimer.hh"
 #include "EventSchedule.hh"
+#include "IPAddressMap.hh"
 #include "IgmpMessageManip.hh"
+#include "IgmpMessageView.hh"
 #include "IgmpMemberFilter.hh"
 
 CLICK_DECLS
@@ -76,7 +77,7 @@ private:
   };
 
   void push_listen(const IPAddress &multicast_address, const IgmpFilterRecord &record);
-  void accept_query(const IgmpMembershipQuery &query);
+  void accept_query(const IgmpMembershipQueryView &query);
   void transmit_membership_report(const IgmpV3MembershipReport &report);
 
   /// Creates a state-changed report.
@@ -97,10 +98,10 @@ private:
   EventSchedule<IgmpTransmitStateChanged> state_changed_schedule;
   /// A map from IP multicast addresses to the number of times they should
   /// be included in a state-changed report.
-  HashMap<IPAddress, int> state_change_transmission_counts;
+  IPAddressMap<int> state_change_transmission_counts;
 
   CallbackTimer<IgmpGeneralQueryResponse> general_response_timer;
-  HashMap<IPAddress, CallbackTimer<IgmpGroupQueryResponse>> group_response_timers;
+  IPAddressMap<CallbackTimer<IgmpGroupQueryResponse>> group_response_timers;
 };
 
 CLICK_ENDDECLS
\ No newline at end of file
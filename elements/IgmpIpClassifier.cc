@@ -0,0 +1,88 @@
+#include "IgmpIpClassifier.hh"
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <click/glue.hh>
+#include <clicknet/ip.h>
+#include "IgmpMessage.hh"
+
+CLICK_DECLS
+IgmpIpClassifier::IgmpIpClassifier()
+{
+}
+
+IgmpIpClassifier::~IgmpIpClassifier()
+{
+}
+
+int IgmpIpClassifier::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    // Nothing to do here.
+    if (cp_va_kparse(conf, this, errh, cpEnd) < 0)
+        return -1;
+    return 0;
+}
+
+int IgmpIpClassifier::classify(Packet *packet)
+{
+    // Check the IP header like 'CheckIPHeader' does.
+    auto ip_header = reinterpret_cast<const click_ip *>(packet->data());
+    if (packet->length() < sizeof(click_ip) || ip_header->ip_v != 4)
+    {
+        return 2;
+    }
+
+    unsigned int header_length = ip_header->ip_hl << 2;
+    unsigned int total_length = ntohs(ip_header->ip_len);
+    if (header_length < sizeof(click_ip)
+        || total_length < header_length
+        || packet->length() < total_length
+        || click_in_cksum(packet->data(), header_length) != 0)
+    {
+        return 2;
+    }
+
+    // Get rid of link-level padding, which would otherwise be mistaken for part of
+    // the IGMP message.
+    if (packet->length() > total_length)
+    {
+        packet->take(packet->length() - total_length);
+    }
+
+    packet->set_ip_header(ip_header, header_length);
+    packet->set_dst_ip_anno(ip_header->ip_dst);
+
+    if (ip_header->ip_p != IP_PROTO_IGMP)
+    {
+        return 1;
+    }
+
+    // Check the IGMP message. The checksum is verified in place, so the message is
+    // never copied.
+    auto igmp_data = packet->data() + header_length;
+    unsigned int igmp_length = total_length - header_length;
+    if (igmp_length < sizeof(IgmpV3MembershipReportHeader)
+        || (!is_igmp_membership_query(igmp_data) && !is_igmp_v3_membership_report(igmp_data))
+        || !verify_igmp_checksum(igmp_data, igmp_length))
+    {
+        return 2;
+    }
+
+    packet->pull(header_length);
+    return 0;
+}
+
+void IgmpIpClassifier::push(int, Packet *packet)
+{
+    int port = classify(packet);
+    if (port == 2 && noutputs() < 3)
+    {
+        packet->kill();
+        return;
+    }
+    output(port).push(packet);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IgmpIpClassifier)
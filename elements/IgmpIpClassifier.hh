@@ -0,0 +1,51 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/element.hh>
+
+CLICK_DECLS
+
+class IgmpIpClassifier;
+
+/// Validates and classifies incoming IP packets in a single pass. This element
+/// replaces a 'CheckIPHeader -> IPClassifier(ip proto igmp, -) -> MarkIPHeader
+/// -> StripIPHeader -> IgmpCheckChecksum' chain.
+///
+/// IP packets are checked the way 'CheckIPHeader' checks them and receive the same
+/// IP header and destination address annotations. IGMP packets are additionally
+/// checked for a sufficient length, a known message type and a valid IGMP checksum.
+/// Packets are never copied: IGMP packets merely have their IP header stripped,
+/// while the IP header annotation keeps pointing at that header.
+class IgmpIpClassifier : public Element
+{
+  public:
+    IgmpIpClassifier();
+    ~IgmpIpClassifier();
+
+    // Description of ports:
+    //
+    //     Input:
+    //         0. IP packets.
+    //
+    //     Output:
+    //         0. IGMP packets, with their IP headers stripped.
+    //         1. Non-IGMP IP packets.
+    //         2. Invalid packets: packets with bad IP headers, truncated IGMP
+    //            messages, IGMP messages of unknown types and IGMP messages with
+    //            incorrect checksums. Dropped if not connected.
+
+    const char *class_name() const { return "IgmpIpClassifier"; }
+    const char *port_count() const { return "1/2-3"; }
+    const char *processing() const { return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+
+    void push(int port, Packet *packet);
+
+  private:
+    /// Validates the given packet, sets its IP header annotation and strips the
+    /// IP headers of IGMP packets. Returns the output port for the packet.
+    int classify(Packet *packet);
+};
+
+CLICK_ENDDECLS
@@ -1,10 +1,11 @@
 #pragma once
 
 #include <click/config.h>
-#include <click/hashmap.hh>
 #include <click/vector.hh>
 #include <clicknet/ip.h>
+#include "IPAddressRangeMap.hh"
 #include "IgmpMessage.hh"
+#include "IgmpSourceSet.hh"
 
 CLICK_DECLS
 
@@ -29,108 +30,39 @@ struct IgmpFilterRecord
     /// The filter record's mode.
     IgmpFilterMode filter_mode;
 
-    /// The filter record's list of source addresses.
-    Vector<IPAddress> source_addresses;
+    /// The filter record's set of source addresses.
+    IgmpSourceSet source_addresses;
 };
 
-/// Creates an IGMP filter record that performs a simple 'join:' it listens to all
-/// messages from a multicast group, without filtering on specific source addresses.
-inline IgmpFilterRecord create_igmp_join_record()
-{
-    return {IgmpFilterMode::Exclude, Vector<IPAddress>()};
-}
-
-/// Creates an IGMP filter record that performs a simple 'leave:' it stops listening to
-/// messages from a multicast group, regardless of source addresses.
-inline IgmpFilterRecord create_igmp_leave_record()
-{
-    return {IgmpFilterMode::Include, Vector<IPAddress>()};
-}
-
-/// Checks if the specified value is equal to any element of the given vector.
-template <typename T>
-bool in_vector(const T &value, const Vector<T> &vector)
-{
-    for (const auto &item : vector)
-    {
-        if (item == value)
-        {
-            return true;
-        }
-    }
-    return false;
-}
-
-/// Creates a vector whose elements are the intersection of the given
-/// vectors.
-template <typename T>
-Vector<T> intersect_vectors(const Vector<T> &left, const Vector<T> &right)
-{
-    Vector<T> results;
-    for (const auto &item : left)
-    {
-        if (in_vector<T>(item, right))
-        {
-            results.push_back(item);
-        }
-    }
-    return results;
-}
-
-/// Creates a vector whose elements are the union of the given
-/// vectors.
-template <typename T>
-Vector<T> union_vectors(const Vector<T> &left, const Vector<T> &right)
+inline bool operator==(const IgmpFilterRecord &left, const IgmpFilterRecord &right)
 {
-    Vector<T> results = left;
-    for (const auto &item : right)
-    {
-        if (!in_vector<T>(item, results))
-        {
-            results.push_back(item);
-        }
-    }
-    return results;
+    return left.filter_mode == right.filter_mode && left.source_addresses == right.source_addresses;
 }
 
-/// Creates a vector whose elements are the difference of the given
-/// vectors.
-template <typename T>
-Vector<T> difference_vectors(const Vector<T> &left, const Vector<T> &right)
+inline bool operator!=(const IgmpFilterRecord &left, const IgmpFilterRecord &right)
 {
-    Vector<T> results;
-    for (const auto &item : left)
-    {
-        if (!in_vector<T>(item, right))
-        {
-            results.push_back(item);
-        }
-    }
-    return results;
+    return !(left == right);
 }
 
-/// Tests if the lhs vector is a subset of the rhs vector.
-template <typename T>
-bool is_subset_vectors(const Vector<T> &subset, const Vector<T> &superset)
+/// Creates an IGMP filter record that performs a simple 'join:' it listens to all
+/// messages from a multicast group, without filtering on specific source addresses.
+inline IgmpFilterRecord create_igmp_join_record()
 {
-    for (const auto& item : subset)
-    {
-        if (!in_vector<T>(item, superset))
-        {
-            return false;
-        }
-    }
-    return true;
+    return {IgmpFilterMode::Exclude, IgmpSourceSet()};
 }
 
-/// Tests if the given vectors contain the same elements.
-template <typename T>
-bool set_equality_vectors(const Vector<T> &left, const Vector<T> &right)
+/// Creates an IGMP filter record that performs a simple 'leave:' it stops listening to
+/// messages from a multicast group, regardless of source addresses.
+inline IgmpFilterRecord create_igmp_leave_record()
 {
-    return is_subset_vectors(left, right) && is_subset_vectors(right, left);
+    return {IgmpFilterMode::Include, IgmpSourceSet()};
 }
 
 /// A "filter" for IGMP packets. It decides which addresses are listened to and which are not.
+///
+/// Blocks of consecutive multicast addresses that are listened to in the same way are
+/// stored as a single range, so a host that joins a whole channel lineup keeps one
+/// record for it instead of one record per group.
 class IgmpMemberFilter
 {
   public:
@@ -140,8 +72,8 @@ class IgmpMemberFilter
         return records.findp(multicast_address);
     }
 
-    typedef typename HashMap<IPAddress, IgmpFilterRecord>::const_iterator iterator;
-    typedef typename HashMap<IPAddress, IgmpFilterRecord>::const_iterator const_iterator;
+    typedef typename IPAddressRangeMap<IgmpFilterRecord>::const_iterator iterator;
+    typedef typename IPAddressRangeMap<IgmpFilterRecord>::const_iterator const_iterator;
 
     /// Gets a constant iterator to the start of this filter's records.
     const_iterator begin() const
@@ -157,7 +89,7 @@ class IgmpMemberFilter
 
     /// Listens to the given multicast address. A list of source addresses are either explicitly included
     /// or excluded. A Boolean result tells if the filter's state has changed.
-    bool listen(const IPAddress &multicast_address, IgmpFilterMode filter_mode, const Vector<IPAddress> &source_addresses)
+    bool listen(const IPAddress &multicast_address, IgmpFilterMode filter_mode, const IgmpSourceSet &source_addresses)
     {
         // According to the spec:
         //
@@ -178,38 +110,36 @@ class IgmpMemberFilter
 
         if (filter_mode == IgmpFilterMode::Include && source_addresses.size() == 0)
         {
-            if (records.findp(multicast_address) == nullptr)
-            {
-                return false;
-            }
-            else
-            {
-                records.erase(multicast_address);
-                return true;
-            }
+            return records.erase(multicast_address);
         }
 
-        bool has_changed = false;
-        IgmpFilterRecord *record_ptr = records.findp(multicast_address);
-        if (record_ptr == nullptr)
-        {
-            records.insert(multicast_address, IgmpFilterRecord());
-            record_ptr = records.findp(multicast_address);
-            has_changed = true;
-        }
-        if (record_ptr->filter_mode != filter_mode)
+        auto record_ptr = records.findp(multicast_address);
+        if (record_ptr != nullptr &&
+            record_ptr->filter_mode == filter_mode &&
+            record_ptr->source_addresses == source_addresses)
         {
-            record_ptr->filter_mode = filter_mode;
-            has_changed = true;
+            return false;
         }
-        
-        if (!set_equality_vectors(record_ptr->source_addresses, source_addresses))
+
+        // Blocks of groups tend to be changed one address after the other, to the same
+        // state. If the previous address is already in the requested state, then
+        // share its record.
+        IPAddress previous_address(htonl(ntohl(multicast_address.addr()) - 1));
+        auto previous_record_ptr = records.findp(previous_address);
+        if (previous_record_ptr != nullptr &&
+            previous_record_ptr->filter_mode == filter_mode &&
+            previous_record_ptr->source_addresses == source_addresses)
         {
-            record_ptr->source_addresses = source_addresses;
-            has_changed = true;
+            records.share(multicast_address, previous_address);
+            return true;
         }
 
-        return has_changed;
+        // Give the address a record of its own. It may have shared a record with
+        // neighboring addresses.
+        auto new_record_ptr = records.claim(multicast_address);
+        new_record_ptr->filter_mode = filter_mode;
+        new_record_ptr->source_addresses = source_addresses;
+        return true;
     }
 
     /// Listens to the given multicast address. A filter record specifies a list of source addresses that
@@ -223,14 +153,14 @@ class IgmpMemberFilter
     /// A Boolean result tells if the filter's state has changed.
     bool join(const IPAddress &multicast_address)
     {
-        return listen(multicast_address, IgmpFilterMode::Exclude, Vector<IPAddress>());
+        return listen(multicast_address, IgmpFilterMode::Exclude, IgmpSourceSet());
     }
 
     /// Leaves the multicast group with the given multicast address.
     /// A Boolean result tells if the filter's state has changed.
     bool leave(const IPAddress &multicast_address)
     {
-        return listen(multicast_address, IgmpFilterMode::Include, Vector<IPAddress>());
+        return listen(multicast_address, IgmpFilterMode::Include, IgmpSourceSet());
     }
 
     /// Tests if the IGMP filter is listening to the given source address for the given multicast
@@ -250,18 +180,18 @@ class IgmpMemberFilter
             return true;
         }
 
-        IgmpFilterRecord *record_ptr = records.findp(multicast_address);
+        auto record_ptr = records.findp(multicast_address);
         if (record_ptr == nullptr)
         {
             return false;
         }
 
         bool is_excluding = record_ptr->filter_mode == IgmpFilterMode::Exclude;
-        return is_excluding != in_vector(source_address, record_ptr->source_addresses);
+        return is_excluding != record_ptr->source_addresses.contains(source_address);
     }
 
   private:
-    HashMap<IPAddress, IgmpFilterRecord> records;
+    IPAddressRangeMap<IgmpFilterRecord> records;
 };
 
 CLICK_ENDDECLS
\ No newline at end of file
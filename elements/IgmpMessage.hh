@@ -1,8 +1,10 @@
 #pragma once
 
 #include <click/config.h>
+#include <click/string.hh>
 #include <click/vector.hh>
 #include <clicknet/ip.h>
+#include "IgmpChecksum.hh"
 
 CLICK_DECLS
 
@@ -254,6 +256,24 @@ enum class IgmpV3GroupRecordType : uint8_t
     ChangeToExcludeMode = 4
 };
 
+/// Gets a human-readable name for the given IGMP version 3 group record type.
+inline String get_igmp_v3_group_record_type_string(IgmpV3GroupRecordType type)
+{
+    switch (type)
+    {
+    case IgmpV3GroupRecordType::ModeIsInclude:
+        return "mode-is-include";
+    case IgmpV3GroupRecordType::ModeIsExclude:
+        return "mode-is-exclude";
+    case IgmpV3GroupRecordType::ChangeToIncludeMode:
+        return "change-to-include";
+    case IgmpV3GroupRecordType::ChangeToExcludeMode:
+        return "change-to-exclude";
+    default:
+        return "unknown (0x" + String::make_numeric((String::uint_large_t)type, 16) + ")";
+    }
+}
+
 /// Describes the header of group record in a membership report.
 struct IgmpV3GroupRecordHeader
 {
@@ -304,14 +324,8 @@ inline bool is_igmp_v3_membership_report(const unsigned char *data)
     return get_igmp_message_type(data) == igmp_v3_membership_report_type;
 }
 
-/// Sets and returns the IGMP checksum of the IGMP message with the given data and size.
-inline uint16_t update_igmp_checksum(unsigned char *data, size_t size)
-{
-    auto header = reinterpret_cast<IgmpMembershipQueryHeader *>(data);
-    header->checksum = 0;
-    header->checksum = click_in_cksum(data, (int)size);
-    return header->checksum;
-}
+/// The offset of the checksum field in every IGMP message.
+const size_t igmp_checksum_offset = offsetof(IgmpMembershipQueryHeader, checksum);
 
 /// Gets the IGMP checksum stored in the given IGMP message.
 inline uint16_t get_igmp_checksum(const unsigned char *data)
@@ -321,13 +335,24 @@ inline uint16_t get_igmp_checksum(const unsigned char *data)
 }
 
 /// Computes and returns an IGMP checksum for the IGMP message with the given data and size.
+/// The message's current checksum field is ignored; the message is not modified.
 inline uint16_t compute_igmp_checksum(const unsigned char *data, size_t size)
 {
-    unsigned char *data_copy = new unsigned char[size];
-    memcpy(data_copy, data, size);
-    uint16_t result = update_igmp_checksum(data_copy, size);
-    delete[] data_copy;
-    return result;
+    return igmp_checksum_compute(data, size, igmp_checksum_offset);
+}
+
+/// Tests if the IGMP message with the given data and size has a correct checksum.
+inline bool verify_igmp_checksum(const unsigned char *data, size_t size)
+{
+    return size >= igmp_checksum_offset + sizeof(uint16_t) && igmp_checksum_verify(data, size);
+}
+
+/// Sets and returns the IGMP checksum of the IGMP message with the given data and size.
+inline uint16_t update_igmp_checksum(unsigned char *data, size_t size)
+{
+    auto header = reinterpret_cast<IgmpMembershipQueryHeader *>(data);
+    header->checksum = compute_igmp_checksum(data, size);
+    return header->checksum;
 }
 
 CLICK_ENDDECLS
\ No newline at end of file
@@ -19,13 +19,21 @@ struct IgmpV3GroupRecord
     /// filter record. A Boolean tells if the group record is supposed to indicate
     /// a change.
     IgmpV3GroupRecord(const IPAddress &multicast_address, const IgmpFilterRecord &record, bool is_change)
-        : multicast_address(multicast_address), source_addresses(record.source_addresses)
+        : type(get_type(record.filter_mode, is_change)),
+          multicast_address(multicast_address),
+          source_addresses(record.source_addresses)
     {
-        type = is_change
-                   ? (record.filter_mode == IgmpFilterMode::Include
+    }
+
+    /// Gets the type of group record that describes a filter record with the given
+    /// mode. A Boolean tells if the group record is supposed to indicate a change.
+    static IgmpV3GroupRecordType get_type(IgmpFilterMode filter_mode, bool is_change)
+    {
+        return is_change
+                   ? (filter_mode == IgmpFilterMode::Include
                           ? IgmpV3GroupRecordType::ChangeToIncludeMode
                           : IgmpV3GroupRecordType::ChangeToExcludeMode)
-                   : (record.filter_mode == IgmpFilterMode::Include
+                   : (filter_mode == IgmpFilterMode::Include
                           ? IgmpV3GroupRecordType::ModeIsInclude
                           : IgmpV3GroupRecordType::ModeIsExclude);
     }
@@ -36,8 +44,8 @@ struct IgmpV3GroupRecord
     /// The record's multicast address.
     IPAddress multicast_address;
 
-    /// The record's list of source addresses.
-    Vector<IPAddress> source_addresses;
+    /// The record's set of source addresses.
+    IgmpSourceSet source_addresses;
 
     /// Tests if this IGMP version 3 group record indicates a change.
     bool is_change() const
@@ -89,7 +97,15 @@ struct IgmpV3GroupRecord
     static IgmpV3GroupRecord read(const unsigned char *(&buffer))
     {
         IgmpV3GroupRecord result;
+        read(buffer, result);
+        return result;
+    }
 
+    /// Reads an IGMP version 3 group record from the given buffer into the given
+    /// record and advances the buffer pointer by the group record's size. The record's
+    /// source set is reused.
+    static void read(const unsigned char *(&buffer), IgmpV3GroupRecord &result)
+    {
         // Parse the header.
         auto header_ptr = reinterpret_cast<const IgmpV3GroupRecordHeader *>(buffer);
         result.type = header_ptr->type;
@@ -99,34 +115,23 @@ struct IgmpV3GroupRecord
         buffer += sizeof(IgmpV3GroupRecordHeader);
 
         // Parse the source addresses.
+        result.source_addresses.clear();
+        result.source_addresses.reserve(number_of_sources);
         for (uint16_t i = 0; i < number_of_sources; i++)
         {
             uint32_t addr = *(reinterpret_cast<const uint32_t *>(buffer));
             buffer += sizeof(uint32_t);
-            result.source_addresses.push_back(IPAddress(addr));
+            result.source_addresses.append_unsorted(IPAddress(addr));
         }
+        result.source_addresses.normalize();
 
         // Skip the auxiliary data.
         buffer += sizeof(uint32_t) * aux_data_length;
-
-        return result;
     }
 
     String get_type_string() const
     {
-        switch (type)
-        {
-        case IgmpV3GroupRecordType::ModeIsInclude:
-            return "mode-is-include";
-        case IgmpV3GroupRecordType::ModeIsExclude:
-            return "mode-is-exclude";
-        case IgmpV3GroupRecordType::ChangeToIncludeMode:
-            return "change-to-include";
-        case IgmpV3GroupRecordType::ChangeToExcludeMode:
-            return "change-to-exclude";
-        default:
-            return "unknown (0x" + String::make_numeric((String::uint_large_t)type, 16) + ")";
-        }
+        return get_igmp_v3_group_record_type_string(type);
     }
 
     String to_string() const
@@ -144,6 +149,18 @@ struct IgmpV3MembershipReport
     /// The membership report's group records.
     Vector<IgmpV3GroupRecord> group_records;
 
+    /// Appends a group record that is equivalent to the specified filter record.
+    /// The filter record's source addresses are copied once, straight into the
+    /// report. A Boolean tells if the group record is supposed to indicate a change.
+    void add_group_record(const IPAddress &multicast_address, const IgmpFilterRecord &record, bool is_change)
+    {
+        group_records.push_back(IgmpV3GroupRecord());
+        auto &group_record = group_records.back();
+        group_record.type = IgmpV3GroupRecord::get_type(record.filter_mode, is_change);
+        group_record.multicast_address = multicast_address;
+        group_record.source_addresses = record.source_addresses;
+    }
+
     /// Gets the size of this report, in bytes.
     size_t get_size() const
     {
@@ -171,7 +188,7 @@ struct IgmpV3MembershipReport
         // Write the group records.
         for (const auto &record : group_records)
         {
-            record.write(buffer);
+            buffer = record.write(buffer);
         }
 
         return buffer;
@@ -188,10 +205,13 @@ struct IgmpV3MembershipReport
         uint16_t number_of_group_records = ntohs(header_ptr->number_of_group_records);
         buffer += sizeof(IgmpV3MembershipReportHeader);
 
-        // Parse the group records.
+        // Parse the group records. They are read in place, because copying a record
+        // copies its source set.
+        result.group_records.reserve(number_of_group_records);
         for (uint16_t i = 0; i < number_of_group_records; i++)
         {
-            result.group_records.push_back(IgmpV3GroupRecord::read(buffer));
+            result.group_records.push_back(IgmpV3GroupRecord());
+            IgmpV3GroupRecord::read(buffer, result.group_records.back());
         }
 
         return result;
@@ -286,7 +306,7 @@ struct IgmpMembershipQuery
     unsigned int query_interval;
 
     /// The source addresses present in this query.
-    Vector<IPAddress> source_addresses;
+    IgmpSourceSet source_addresses;
 
     /// Tests if this membership query is a general query.
     bool is_general_query() const
@@ -354,12 +374,14 @@ struct IgmpMembershipQuery
         buffer += sizeof(IgmpMembershipQueryHeader);
 
         // Parse the source addresses.
+        result.source_addresses.reserve(number_of_sources);
         for (uint16_t i = 0; i < number_of_sources; i++)
         {
             uint32_t addr = *(reinterpret_cast<const uint32_t *>(buffer));
             buffer += sizeof(uint32_t);
-            result.source_addresses.push_back(IPAddress(addr));
+            result.source_addresses.append_unsorted(IPAddress(addr));
         }
+        result.source_addresses.normalize();
 
         return result;
     }
@@ -0,0 +1,338 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <clicknet/ip.h>
+#include "IgmpMessage.hh"
+
+CLICK_DECLS
+
+/// A read-only view of a list of source addresses in an IGMP message. The view does
+/// not own the addresses: it points straight into the message's bytes.
+class IgmpSourceListView
+{
+  public:
+    /// Iterates over the source addresses in a source list view.
+    class const_iterator
+    {
+      public:
+        const_iterator(const unsigned char *data)
+            : data(data)
+        {
+        }
+
+        IPAddress operator*() const
+        {
+            return IPAddress(*reinterpret_cast<const uint32_t *>(data));
+        }
+
+        const_iterator &operator++()
+        {
+            data += sizeof(uint32_t);
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator result = *this;
+            ++(*this);
+            return result;
+        }
+
+        bool operator==(const const_iterator &other) const { return data == other.data; }
+        bool operator!=(const const_iterator &other) const { return data != other.data; }
+
+      private:
+        const unsigned char *data;
+    };
+
+    typedef const_iterator iterator;
+
+    /// Creates a view of the given number of source addresses, starting at the
+    /// given address.
+    IgmpSourceListView(const unsigned char *data, int count)
+        : data(data), count(count)
+    {
+    }
+
+    /// Gets the number of source addresses in this view.
+    int size() const { return count; }
+
+    /// Tests if this view contains no source addresses.
+    bool empty() const { return count == 0; }
+
+    /// Gets the source address at the given position.
+    IPAddress operator[](int index) const
+    {
+        assert(index >= 0 && index < count);
+        return *begin_at(index);
+    }
+
+    const_iterator begin() const { return const_iterator(data); }
+    const_iterator end() const { return const_iterator(data + sizeof(uint32_t) * count); }
+
+  private:
+    const_iterator begin_at(int index) const { return const_iterator(data + sizeof(uint32_t) * index); }
+
+    const unsigned char *data;
+    int count;
+};
+
+/// A read-only view of an IGMP membership query. A view does not copy the message:
+/// all fields are read from the underlying bytes when they are accessed.
+///
+/// A view can be constructed for any buffer, but its fields may only be accessed if
+/// 'valid' returns true.
+class IgmpMembershipQueryView
+{
+  public:
+    /// Creates a view of the IGMP membership query in the given buffer.
+    IgmpMembershipQueryView(const unsigned char *data, size_t length)
+        : data(data), length(length)
+    {
+    }
+
+    /// Tests if the buffer is large enough to contain this query's header and all of
+    /// its source addresses.
+    bool valid() const
+    {
+        return length >= sizeof(IgmpMembershipQueryHeader)
+            && length >= get_size();
+    }
+
+    /// Gets this query's size, in bytes, as derived from its header.
+    size_t get_size() const
+    {
+        return sizeof(IgmpMembershipQueryHeader) + sizeof(uint32_t) * get_number_of_sources();
+    }
+
+    /// Specifies the maximum amount of time allowed before sending a responding report.
+    unsigned int get_max_resp_time() const { return header()->get_max_resp_time(); }
+
+    /// Gets the address of the group that is queried. This address is zero for
+    /// general queries.
+    IPAddress get_group_address() const { return IPAddress(header()->group_address); }
+
+    /// Tests if this query's Suppress Router-Side Processing flag is set.
+    bool suppress_router_side_processing() const { return (header()->flags & 0x08) == 0x08; }
+
+    /// Gets the Querier's Robustness Variable.
+    uint8_t get_robustness_variable() const { return header()->flags & 0x07; }
+
+    /// Gets the Querier's Query Interval.
+    unsigned int get_query_interval() const { return header()->get_query_interval(); }
+
+    /// Gets the number of source addresses in this query.
+    int get_number_of_sources() const { return ntohs(header()->number_of_sources); }
+
+    /// Gets the source addresses in this query.
+    IgmpSourceListView get_source_addresses() const
+    {
+        return IgmpSourceListView(data + sizeof(IgmpMembershipQueryHeader), get_number_of_sources());
+    }
+
+    /// Tests if this membership query is a general query.
+    bool is_general_query() const
+    {
+        return header()->group_address == 0;
+    }
+
+    /// Tests if this membership query is a group-specific query.
+    bool is_group_specific_query() const
+    {
+        return !is_general_query() && get_number_of_sources() == 0;
+    }
+
+  private:
+    const IgmpMembershipQueryHeader *header() const
+    {
+        return reinterpret_cast<const IgmpMembershipQueryHeader *>(data);
+    }
+
+    const unsigned char *data;
+    size_t length;
+};
+
+/// A read-only view of a group record in an IGMP version 3 membership report.
+class IgmpV3GroupRecordView
+{
+  public:
+    /// Creates a view of the group record at the start of the given buffer.
+    IgmpV3GroupRecordView(const unsigned char *data, size_t length)
+        : data(data), length(length)
+    {
+    }
+
+    /// Tests if the buffer is large enough to contain this record's header, its
+    /// source addresses and its auxiliary data.
+    bool valid() const
+    {
+        return length >= sizeof(IgmpV3GroupRecordHeader)
+            && length >= get_size();
+    }
+
+    /// Gets this record's size, in bytes, as derived from its header.
+    size_t get_size() const
+    {
+        return sizeof(IgmpV3GroupRecordHeader) + header()->get_payload_size();
+    }
+
+    /// Gets the record type.
+    IgmpV3GroupRecordType get_type() const { return header()->type; }
+
+    /// Gets the record's multicast address.
+    IPAddress get_multicast_address() const { return IPAddress(header()->multicast_address); }
+
+    /// Gets the number of source addresses in this record.
+    int get_number_of_sources() const { return ntohs(header()->number_of_sources); }
+
+    /// Gets the source addresses in this record.
+    IgmpSourceListView get_source_addresses() const
+    {
+        return IgmpSourceListView(data + sizeof(IgmpV3GroupRecordHeader), get_number_of_sources());
+    }
+
+    String to_string() const
+    {
+        return "IGMPv3 group record: type: " +
+               get_igmp_v3_group_record_type_string(get_type()) + ", multicast address: " +
+               get_multicast_address().unparse() + ", " +
+               String(get_number_of_sources()) + " source addresses.";
+    }
+
+  private:
+    const IgmpV3GroupRecordHeader *header() const
+    {
+        return reinterpret_cast<const IgmpV3GroupRecordHeader *>(data);
+    }
+
+    const unsigned char *data;
+    size_t length;
+};
+
+/// A read-only view of an IGMP version 3 membership report. Its group records can be
+/// iterated over without copying them.
+///
+/// A view can be constructed for any buffer, but its group records may only be
+/// accessed if 'valid' returns true.
+class IgmpV3MembershipReportView
+{
+  public:
+    /// Iterates over the group records in a membership report view.
+    class const_iterator
+    {
+      public:
+        const_iterator(const unsigned char *data, size_t length)
+            : data(data), length(length)
+        {
+        }
+
+        IgmpV3GroupRecordView operator*() const
+        {
+            return IgmpV3GroupRecordView(data, length);
+        }
+
+        const_iterator &operator++()
+        {
+            size_t size = IgmpV3GroupRecordView(data, length).get_size();
+            data += size;
+            length -= size;
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            const_iterator result = *this;
+            ++(*this);
+            return result;
+        }
+
+        bool operator==(const const_iterator &other) const { return data == other.data; }
+        bool operator!=(const const_iterator &other) const { return data != other.data; }
+
+      private:
+        const unsigned char *data;
+        size_t length;
+    };
+
+    typedef const_iterator iterator;
+
+    /// Creates a view of the IGMP version 3 membership report in the given buffer.
+    IgmpV3MembershipReportView(const unsigned char *data, size_t length)
+        : data(data), length(length), records_end(nullptr)
+    {
+        validate();
+    }
+
+    /// Tests if the buffer is large enough to contain this report's header and all
+    /// of its group records.
+    bool valid() const
+    {
+        return records_end != nullptr;
+    }
+
+    /// Gets this report's size, in bytes, as derived from its header and group
+    /// records. The report must be valid.
+    size_t get_size() const
+    {
+        assert(valid());
+        return records_end - data;
+    }
+
+    /// Gets the number of group records in this report.
+    int get_number_of_group_records() const
+    {
+        return ntohs(header()->number_of_group_records);
+    }
+
+    const_iterator begin() const
+    {
+        assert(valid());
+        return const_iterator(data + sizeof(IgmpV3MembershipReportHeader), length - sizeof(IgmpV3MembershipReportHeader));
+    }
+
+    const_iterator end() const
+    {
+        assert(valid());
+        return const_iterator(records_end, length - (records_end - data));
+    }
+
+  private:
+    const IgmpV3MembershipReportHeader *header() const
+    {
+        return reinterpret_cast<const IgmpV3MembershipReportHeader *>(data);
+    }
+
+    /// Walks the group records once to check that they all fit in the buffer. This
+    /// is what allows the iterators to skip bounds checks.
+    void validate()
+    {
+        if (length < sizeof(IgmpV3MembershipReportHeader))
+        {
+            return;
+        }
+
+        const unsigned char *record_ptr = data + sizeof(IgmpV3MembershipReportHeader);
+        size_t remaining = length - sizeof(IgmpV3MembershipReportHeader);
+        int number_of_group_records = get_number_of_group_records();
+        for (int i = 0; i < number_of_group_records; i++)
+        {
+            IgmpV3GroupRecordView record(record_ptr, remaining);
+            if (!record.valid())
+            {
+                return;
+            }
+            size_t size = record.get_size();
+            record_ptr += size;
+            remaining -= size;
+        }
+        records_end = record_ptr;
+    }
+
+    const unsigned char *data;
+    size_t length;
+    /// A pointer just past the last group record, or null if the report is invalid.
+    const unsigned char *records_end;
+};
+
+CLICK_ENDDECLS
@@ -0,0 +1,298 @@
+#include "IgmpMulticastRouter.hh"
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include <clicknet/ip.h>
+#include "IgmpRouterFilter.hh"
+#include "IgmpRouterInterface.hh"
+
+CLICK_DECLS
+
+/// 224.0.0.0/24, the Local Network Control Block. Multicast routers must not
+/// forward packets sent to addresses in this range.
+const IPAddress local_network_control_block("224.0.0.0");
+
+IgmpMulticastRouter::IgmpMulticastRouter()
+{
+}
+
+IgmpMulticastRouter::~IgmpMulticastRouter()
+{
+    for (auto iface : interfaces)
+    {
+        delete iface;
+    }
+}
+
+int IgmpMulticastRouter::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    // The SSM range and the limits apply to every interface. Keywords are parsed
+    // first, so that only the interface addresses remain.
+    IPAddress ssm_prefix = default_ssm_prefix;
+    IPAddress ssm_mask = default_ssm_mask;
+    IgmpRouterLimits limits;
+    String overflow_policy = "reject";
+    unsigned int report_rate = 0;
+    unsigned int report_burst = 0;
+    int report_sources = IgmpReportRateLimiter::default_max_sources;
+    if (cp_va_kparse_remove_keywords(conf, this, errh,
+                                     "SSM_RANGE", cpkN, cpIPPrefix, &ssm_prefix, &ssm_mask,
+                                     "MAX_GROUPS", cpkN, cpUnsigned, &limits.max_groups,
+                                     "MAX_SOURCES_PER_GROUP", cpkN, cpUnsigned, &limits.max_sources_per_group,
+                                     "MAX_SOURCE_RECORDS", cpkN, cpUnsigned, &limits.max_source_records,
+                                     "OVERFLOW_POLICY", cpkN, cpWord, &overflow_policy,
+                                     "REPORT_RATE", cpkN, cpUnsigned, &report_rate,
+                                     "REPORT_BURST", cpkN, cpUnsigned, &report_burst,
+                                     "REPORT_SOURCES", cpkN, cpInteger, &report_sources,
+                                     cpEnd) < 0)
+        return -1;
+
+    if (!parse_igmp_overflow_policy(overflow_policy, limits.overflow_policy))
+        return errh->error("OVERFLOW_POLICY must be 'reject' or 'exclude'");
+    if (!normalize_igmp_ssm_range(ssm_prefix, ssm_mask))
+        return errh->error("SSM_RANGE must be a range of multicast addresses");
+
+    if (conf.size() == 0)
+        return errh->error("expected at least one interface address");
+    if (conf.size() > max_interfaces)
+        return errh->error("too many interfaces; at most %d are supported", max_interfaces);
+
+    int interface_count = conf.size();
+    if (ninputs() != 2 * interface_count
+        || noutputs() < 2 * interface_count + 1 || noutputs() > 2 * interface_count + 2)
+        return errh->error(
+            "a router with %d interfaces needs %d inputs and %d or %d outputs",
+            interface_count, 2 * interface_count, 2 * interface_count + 1, 2 * interface_count + 2);
+
+    Vector<IPAddress> addresses;
+    for (const auto &arg : conf)
+    {
+        IPAddress address;
+        if (!cp_ip_address(arg, &address, this))
+            return errh->error("expected IP address, not '%s'", arg.c_str());
+        addresses.push_back(address);
+    }
+
+    for (int i = 0; i < interface_count; i++)
+    {
+        auto iface = new IgmpRouterInterface(this, i);
+        interfaces.push_back(iface);
+        iface->get_filter().set_ssm_range(ssm_prefix, ssm_mask);
+        iface->get_filter().get_limits() = limits;
+        if (iface->get_report_limiter().configure(report_rate, report_burst, report_sources, errh) < 0)
+            return -1;
+        iface->start(addresses[i]);
+    }
+
+    return 0;
+}
+
+void IgmpMulticastRouter::push(int port, Packet *packet)
+{
+    int interface_count = interfaces.size();
+    if (port < interface_count)
+    {
+        if (!interfaces[port]->admit_igmp_packet(packet))
+        {
+            if (noutputs() > 2 * interface_count + 1)
+                output(2 * interface_count + 1).push(packet);
+            else
+                packet->kill();
+            return;
+        }
+
+        interfaces[port]->handle_igmp_packet(packet);
+        return;
+    }
+
+    assert(port < 2 * interface_count);
+    auto ip_header = (const click_ip *)packet->data();
+    IPAddress destination(ip_header->ip_dst);
+    if (destination.matches_prefix(local_network_control_block, IPAddress::make_prefix(24)))
+    {
+        // Link-local multicast packets never leave the network they were sent on.
+        packet->kill();
+    }
+    else if (destination.is_multicast())
+    {
+        forward(port - interface_count, packet);
+    }
+    else
+    {
+        output(2 * interface_count).push(packet);
+    }
+}
+
+uint64_t IgmpMulticastRouter::get_generation() const
+{
+    uint64_t result = 0;
+    for (auto iface : interfaces)
+    {
+        result += iface->get_filter().get_generation();
+    }
+    return result;
+}
+
+uint32_t IgmpMulticastRouter::get_forwarding_mask(const IPAddress &multicast_address, const IPAddress &source_address)
+{
+    auto now = Timestamp::recent_steady();
+    auto generation = get_generation();
+    auto cached_mask = forwarding_cache.lookup(multicast_address, source_address, generation, now);
+    if (cached_mask != nullptr)
+    {
+        return *cached_mask;
+    }
+
+    // Ask every interface and remember when the first of their answers goes stale.
+    uint32_t mask = 0;
+    Timestamp expiry;
+    for (int i = 0; i < interfaces.size(); i++)
+    {
+        Timestamp interface_expiry;
+        if (interfaces[i]->get_filter().is_listening_to(multicast_address, source_address, interface_expiry))
+        {
+            mask |= (uint32_t)1 << i;
+        }
+        if (interface_expiry != Timestamp() && (expiry == Timestamp() || interface_expiry < expiry))
+        {
+            expiry = interface_expiry;
+        }
+    }
+
+    forwarding_cache.store(multicast_address, source_address, generation, expiry, mask);
+    return mask;
+}
+
+void IgmpMulticastRouter::forward(int arrival_interface, Packet *packet)
+{
+    auto ip_header = (const click_ip *)packet->data();
+    uint32_t mask = get_forwarding_mask(ip_header->ip_dst, ip_header->ip_src);
+
+    // Never send a packet back to the network it came from: the hosts on that
+    // network have already received it.
+    mask &= ~((uint32_t)1 << arrival_interface);
+    if (mask == 0)
+    {
+        packet->kill();
+        return;
+    }
+
+    // Clone the packet for all but the last interface, which gets the original.
+    int interface_count = interfaces.size();
+    while (true)
+    {
+        int i = __builtin_ctz(mask);
+        mask &= mask - 1;
+        if (mask == 0)
+        {
+            output(interface_count + i).push(packet);
+            return;
+        }
+
+        if (Packet *clone = packet->clone())
+        {
+            output(interface_count + i).push(clone);
+        }
+    }
+}
+
+int IgmpMulticastRouter::config(const String &conf, Element *e, void *, ErrorHandler *errh)
+{
+    // Settings apply to all interfaces.
+    IgmpMulticastRouter *self = (IgmpMulticastRouter *)e;
+    for (auto iface : self->interfaces)
+    {
+        if (iface->configure_variables(conf, errh) < 0)
+            return -1;
+    }
+    return 0;
+}
+
+String IgmpMulticastRouter::pool_stats(Element *e, void *)
+{
+    IgmpMulticastRouter *self = (IgmpMulticastRouter *)e;
+    String result;
+    for (auto iface : self->interfaces)
+    {
+        result += "interface " + iface->get_address().unparse() + ":\n";
+        result += iface->get_filter().get_pool_stats();
+    }
+    return result;
+}
+
+String IgmpMulticastRouter::group_record_count(Element *e, void *thunk)
+{
+    // Counts are summed over all interfaces.
+    IgmpMulticastRouter *self = (IgmpMulticastRouter *)e;
+    int count = 0;
+    for (auto iface : self->interfaces)
+    {
+        const IgmpRouterFilter &filter = iface->get_filter();
+        count += thunk == 0 ? filter.get_live_record_count() : filter.get_allocated_record_count();
+    }
+    return String(count);
+}
+
+String IgmpMulticastRouter::limit_hits(Element *e, void *thunk)
+{
+    // Counts are summed over all interfaces.
+    IgmpMulticastRouter *self = (IgmpMulticastRouter *)e;
+    uint64_t count = 0;
+    for (auto iface : self->interfaces)
+    {
+        const IgmpRouterLimitCounters &counters = iface->get_filter().get_limit_counters();
+        switch ((intptr_t)thunk)
+        {
+        case 0:
+            count += counters.group_limit_hits;
+            break;
+        case 1:
+            count += counters.group_source_limit_hits;
+            break;
+        default:
+            count += counters.source_record_limit_hits;
+            break;
+        }
+    }
+    return String(count);
+}
+
+String IgmpMulticastRouter::report_drops(Element *e, void *thunk)
+{
+    IgmpMulticastRouter *self = (IgmpMulticastRouter *)e;
+    if (thunk == 0)
+    {
+        String result;
+        for (auto iface : self->interfaces)
+        {
+            result += "interface " + iface->get_address().unparse() + ":\n";
+            result += iface->get_report_limiter().drops_to_string();
+        }
+        return result;
+    }
+
+    uint64_t count = 0;
+    for (auto iface : self->interfaces)
+    {
+        count += iface->get_report_limiter().get_total_drops();
+    }
+    return String(count);
+}
+
+void IgmpMulticastRouter::add_handlers()
+{
+    add_write_handler("config", &config, (void *)0);
+    add_read_handler("pool_stats", &pool_stats, (void *)0);
+    add_read_handler("live_group_records", &group_record_count, (void *)0);
+    add_read_handler("allocated_group_records", &group_record_count, (void *)1);
+    add_read_handler("group_limit_hits", &limit_hits, (void *)0);
+    add_read_handler("group_source_limit_hits", &limit_hits, (void *)1);
+    add_read_handler("source_record_limit_hits", &limit_hits, (void *)2);
+    add_read_handler("report_drops", &report_drops, (void *)0);
+    add_read_handler("total_report_drops", &report_drops, (void *)1);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IgmpMulticastRouter)
+ELEMENT_REQUIRES(IgmpRouterInterface)
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/element.hh>
+#include <click/vector.hh>
+#include "IgmpForwardingCache.hh"
+#include "IgmpRouterInterface.hh"
+
+CLICK_DECLS
+
+class IgmpMulticastRouter;
+
+/// An IGMP router for several networks at once. It is configured with the addresses
+/// of its interfaces, one per attached network, and keeps the group state for each
+/// of those networks.
+///
+/// Unlike a set of 'IgmpRouter' elements, which each need their own copy of every
+/// data packet, this element looks up the set of interfaces that want a packet just
+/// once. That set is represented as a bitmask and cached per (source, group) pair, so
+/// a packet is only cloned for the interfaces it actually goes out on.
+class IgmpMulticastRouter : public Element
+{
+  public:
+    IgmpMulticastRouter();
+    ~IgmpMulticastRouter();
+
+    // Description of ports, for a router with N interfaces:
+    //
+    //     Input:
+    //         0 to N-1. Incoming IGMP packets from interface i, with their IP
+    //                   headers stripped.
+    //
+    //         N to 2N-1. Incoming non-IGMP IP packets from interface i - N.
+    //
+    //     Output:
+    //         0 to N-1. Generated IGMP packets for interface i.
+    //
+    //         N to 2N-1. Multicast IP packets for interface i - N.
+    //
+    //         2N. Incoming IP packets which are not multicast packets. These
+    //             should be routed as unicast packets.
+    //
+    //         2N+1. Incoming IGMP membership reports which were over their
+    //               source's rate limit. Optional; dropped if not connected.
+
+    // Configuration: the addresses of the router's interfaces, in order, followed by
+    // any of these keywords:
+    //
+    //     SSM_RANGE: the range of group addresses that are used for source-specific
+    //         multicast, as for 'IgmpRouter'. Defaults to 232.0.0.0/8.
+    //
+    //     MAX_GROUPS, MAX_SOURCES_PER_GROUP, MAX_SOURCE_RECORDS, OVERFLOW_POLICY:
+    //         limits on the state that the router keeps, as for 'IgmpRouter'. The
+    //         limits apply to each interface separately.
+    //
+    //     REPORT_RATE, REPORT_BURST, REPORT_SOURCES: the rate limit on membership
+    //         reports, as for 'IgmpRouter'. Every interface limits the reports
+    //         that arrive on it separately.
+    //
+    // The group_limit_hits, group_source_limit_hits and source_record_limit_hits
+    // handlers count how often each limit was hit, over all interfaces. The
+    // report_drops handler lists the reports that were dropped per source and
+    // interface, and the total_report_drops handler counts them.
+
+    const char *class_name() const { return "IgmpMulticastRouter"; }
+    const char *port_count() const { return "-/-"; }
+    const char *processing() const { return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+
+    static int config(const String &conf, Element *e, void *thunk, ErrorHandler *errh);
+    static String pool_stats(Element *e, void *thunk);
+    static String group_record_count(Element *e, void *thunk);
+    static String limit_hits(Element *e, void *thunk);
+    static String report_drops(Element *e, void *thunk);
+
+    void add_handlers();
+
+    void push(int port, Packet *packet);
+
+  private:
+    /// The largest number of interfaces a router can have. This is the number of
+    /// bits in an interface mask.
+    static const int max_interfaces = 32;
+
+    /// Gets a generation for the router's state as a whole. Every interface's
+    /// generation only ever increases, so their sum changes whenever one of them does.
+    uint64_t get_generation() const;
+
+    /// Gets the mask of interfaces that listen to packets from the given source to
+    /// the given multicast address, consulting the forwarding cache first.
+    uint32_t get_forwarding_mask(const IPAddress &multicast_address, const IPAddress &source_address);
+
+    /// Forwards a multicast packet that arrived on the given interface.
+    void forward(int arrival_interface, Packet *packet);
+
+    /// The router's interfaces. Interfaces are allocated one by one because their
+    /// timers refer to them.
+    Vector<IgmpRouterInterface *> interfaces;
+    /// Caches forwarding masks for data packets.
+    IgmpForwardingCache<uint32_t> forwarding_cache;
+};
+
+CLICK_ENDDECLS
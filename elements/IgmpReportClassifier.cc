@@ -0,0 +1,59 @@
+#include "IgmpReportClassifier.hh"
+
+#include <click/config.h>
+#include <click/confparse.hh>
+#include <click/error.hh>
+#include "IgmpMessage.hh"
+#include "IgmpMessageView.hh"
+
+CLICK_DECLS
+IgmpReportClassifier::IgmpReportClassifier()
+{
+}
+
+IgmpReportClassifier::~IgmpReportClassifier()
+{
+}
+
+int IgmpReportClassifier::configure(Vector<String> &conf, ErrorHandler *errh)
+{
+    // Nothing to do here.
+    if (cp_va_kparse(conf, this, errh, cpEnd) < 0)
+        return -1;
+    return 0;
+}
+
+int IgmpReportClassifier::classify(const Packet *packet) const
+{
+    if (packet->length() < sizeof(IgmpV3MembershipReportHeader)
+        || !is_igmp_v3_membership_report(packet->data()))
+    {
+        return 0;
+    }
+
+    // Truncated reports are dropped by the router anyway, so there is no point in
+    // letting them jump the queue.
+    IgmpV3MembershipReportView report(packet->data(), packet->length());
+    if (!report.valid())
+    {
+        return 1;
+    }
+
+    for (auto group : report)
+    {
+        auto type = group.get_type();
+        if (type != IgmpV3GroupRecordType::ModeIsInclude && type != IgmpV3GroupRecordType::ModeIsExclude)
+        {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+void IgmpReportClassifier::push(int, Packet *packet)
+{
+    output(classify(packet)).push(packet);
+}
+
+CLICK_ENDDECLS
+EXPORT_ELEMENT(IgmpReportClassifier)
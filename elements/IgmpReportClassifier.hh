@@ -0,0 +1,48 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/element.hh>
+
+CLICK_DECLS
+
+class IgmpReportClassifier;
+
+/// Sorts IGMP packets by urgency, so that they can be queued separately in front of
+/// a router. State-change reports tell the router that a host has joined or left a
+/// group, and the router should act on them right away. Current-state reports only
+/// refresh state that the router already has until the group membership interval
+/// runs out, so they can wait, or be shed if the router is overloaded.
+///
+/// A report is a current-state report if all of its group records are
+/// MODE_IS_INCLUDE or MODE_IS_EXCLUDE records. Reports with any other records, as
+/// well as all other IGMP messages, are sent to the urgent output. Packets are not
+/// validated beyond that; the router checks them when it parses them.
+class IgmpReportClassifier : public Element
+{
+  public:
+    IgmpReportClassifier();
+    ~IgmpReportClassifier();
+
+    // Description of ports:
+    //
+    //     Input:
+    //         0. IGMP packets, with their IP headers stripped.
+    //
+    //     Output:
+    //         0. State-change reports, queries and other IGMP packets.
+    //         1. Current-state reports.
+
+    const char *class_name() const { return "IgmpReportClassifier"; }
+    const char *port_count() const { return "1/2"; }
+    const char *processing() const { return PUSH; }
+
+    int configure(Vector<String> &, ErrorHandler *);
+
+    void push(int port, Packet *packet);
+
+  private:
+    /// Returns the output port for the given IGMP packet.
+    int classify(const Packet *packet) const;
+};
+
+CLICK_ENDDECLS
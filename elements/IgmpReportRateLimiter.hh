@@ -0,0 +1,246 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/error.hh>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <clicknet/ip.h>
+#include "IPAddressMap.hh"
+
+CLICK_DECLS
+
+/// The token bucket of a single report source.
+struct IgmpReportBucket
+{
+    /// The number of tokens in the bucket, in thousandths of a token.
+    uint64_t millitokens = 0;
+    /// The time at which tokens were last added to the bucket, in milliseconds.
+    uint64_t refill_msec = 0;
+    /// The number of reports from the source that were over the limit.
+    uint64_t drops = 0;
+};
+
+/// Limits the rate at which membership reports are accepted from each source
+/// address, with a token bucket per source. A source may send up to 'burst' reports
+/// at once and 'rate' reports per second after that.
+///
+/// Buckets are only kept for sources that have sent reports recently: once the
+/// number of buckets has doubled since the last time, all buckets that have filled
+/// up again are pruned, since a full bucket is indistinguishable from a new one.
+///
+/// Pruning alone bounds the number of buckets by the number of sources that report
+/// within the time it takes to refill a bucket, which spoofed sources can make very
+/// large. The number of buckets is therefore also capped: a new source that would
+/// exceed the cap first evicts the quarter of the buckets that were used least
+/// recently. An evicted source starts over with a full bucket, so the cap should
+/// comfortably exceed the number of hosts on the network. The drops of pruned and
+/// evicted sources are only kept in the total.
+class IgmpReportRateLimiter final
+{
+  public:
+    /// The default largest number of sources that a limiter keeps a bucket for.
+    static const int default_max_sources = 4096;
+
+    IgmpReportRateLimiter()
+        : rate(0), burst(0), max_sources(default_max_sources), pruned_drops(0), prune_limit(min_prune_limit)
+    {
+    }
+
+    IgmpReportRateLimiter(const IgmpReportRateLimiter &) = delete;
+    IgmpReportRateLimiter &operator=(const IgmpReportRateLimiter &) = delete;
+
+    /// Sets the number of reports per second that a source may send, the number of
+    /// reports that it may send at once and the largest number of sources to keep a
+    /// bucket for. Every element that limits reports configures its limiter with
+    /// this method, so they all treat these settings the same way:
+    ///
+    ///   * a rate of zero disables the limiter: all reports are admitted;
+    ///   * a burst of zero means one second's worth of reports at the given rate;
+    ///   * the number of sources must be positive.
+    ///
+    /// Reports an error and returns -1 if the settings are invalid. The limiter is
+    /// then left unchanged.
+    int configure(unsigned int reports_per_second, unsigned int burst_size, int max_source_count, ErrorHandler *errh)
+    {
+        if (max_source_count < 1)
+            return errh->error("the number of report sources to keep track of must be positive");
+
+        rate = reports_per_second;
+        burst = burst_size != 0 ? burst_size : (rate != 0 ? rate : 1);
+        max_sources = max_source_count;
+        buckets.clear();
+        prune_limit = min_prune_limit;
+        return 0;
+    }
+
+    /// Tests if this limiter limits anything at all.
+    bool enabled() const { return rate != 0; }
+
+    /// Takes a token from the given source's bucket at the given time, in
+    /// milliseconds. Returns false, and counts a drop, if the bucket is empty.
+    bool admit(const IPAddress &source_address, uint64_t now_msec)
+    {
+        if (!enabled())
+        {
+            return true;
+        }
+
+        auto bucket = buckets.findp(source_address);
+        if (bucket == nullptr)
+        {
+            prune_if_grown(now_msec);
+            if (buckets.size() >= max_sources)
+            {
+                evict_least_recently_used();
+            }
+
+            IgmpReportBucket new_bucket;
+            new_bucket.millitokens = capacity() - 1000;
+            new_bucket.refill_msec = now_msec;
+            buckets.insert(source_address, new_bucket);
+            return true;
+        }
+
+        refill(*bucket, now_msec);
+        if (bucket->millitokens < 1000)
+        {
+            bucket->drops++;
+            return false;
+        }
+        bucket->millitokens -= 1000;
+        return true;
+    }
+
+    /// Gets the number of sources that have a bucket.
+    int size() const { return buckets.size(); }
+
+    /// Gets the total number of reports that were over the limit.
+    uint64_t get_total_drops() const
+    {
+        uint64_t result = pruned_drops;
+        for (auto it = buckets.begin(); it != buckets.end(); ++it)
+        {
+            result += it.value().drops;
+        }
+        return result;
+    }
+
+    /// Lists the number of reports that were over the limit for every source that
+    /// has a bucket and has had reports dropped, one source per line.
+    String drops_to_string() const
+    {
+        String result;
+        for (auto it = buckets.begin(); it != buckets.end(); ++it)
+        {
+            if (it.value().drops != 0)
+            {
+                result += it.key().unparse() + " " + String(it.value().drops) + "\n";
+            }
+        }
+        return result;
+    }
+
+  private:
+    /// The number of buckets below which buckets are never pruned.
+    static const int min_prune_limit = 64;
+
+    /// Gets the number of tokens in a full bucket, in thousandths of a token.
+    uint64_t capacity() const { return (uint64_t)burst * 1000; }
+
+    /// Adds the tokens that a bucket has earned since it was last refilled. A rate
+    /// of 'rate' tokens per second is 'rate' thousandths of a token per millisecond.
+    void refill(IgmpReportBucket &bucket, uint64_t now_msec) const
+    {
+        if (now_msec <= bucket.refill_msec)
+        {
+            return;
+        }
+
+        uint64_t elapsed_msec = now_msec - bucket.refill_msec;
+        uint64_t room = capacity() - bucket.millitokens;
+        bucket.millitokens += elapsed_msec >= room / rate + 1 ? room : elapsed_msec * rate;
+        bucket.refill_msec = now_msec;
+    }
+
+    /// Prunes all full buckets if the number of buckets has doubled since the last
+    /// time.
+    void prune_if_grown(uint64_t now_msec)
+    {
+        if (buckets.size() < prune_limit)
+        {
+            return;
+        }
+
+        Vector<IPAddress> full_sources;
+        for (auto it = buckets.begin(); it != buckets.end(); ++it)
+        {
+            refill(it.value(), now_msec);
+            if (it.value().millitokens == capacity())
+            {
+                full_sources.push_back(it.key());
+                pruned_drops += it.value().drops;
+            }
+        }
+        for (const auto &source_address : full_sources)
+        {
+            buckets.erase(source_address);
+        }
+
+        int remaining = buckets.size();
+        prune_limit = 2 * remaining < min_prune_limit ? min_prune_limit : 2 * remaining;
+    }
+
+    static int compare_msec(const void *left, const void *right, void *)
+    {
+        uint64_t left_msec = *reinterpret_cast<const uint64_t *>(left);
+        uint64_t right_msec = *reinterpret_cast<const uint64_t *>(right);
+        return left_msec < right_msec ? -1 : (left_msec > right_msec ? 1 : 0);
+    }
+
+    /// Evicts at least a quarter of the buckets: those that were refilled, i.e., used,
+    /// least recently. Since the next eviction is at least that many new sources away,
+    /// sorting the refill times costs amortized logarithmic time per new source.
+    void evict_least_recently_used()
+    {
+        Vector<uint64_t> refill_times;
+        for (auto it = buckets.begin(); it != buckets.end(); ++it)
+        {
+            refill_times.push_back(it.value().refill_msec);
+        }
+        click_qsort(refill_times.begin(), refill_times.size(), sizeof(uint64_t), &compare_msec, nullptr);
+        uint64_t cutoff_msec = refill_times[(refill_times.size() - 1) / 4];
+
+        Vector<IPAddress> evicted_sources;
+        for (auto it = buckets.begin(); it != buckets.end(); ++it)
+        {
+            if (it.value().refill_msec <= cutoff_msec)
+            {
+                evicted_sources.push_back(it.key());
+                pruned_drops += it.value().drops;
+            }
+        }
+        for (const auto &source_address : evicted_sources)
+        {
+            buckets.erase(source_address);
+        }
+    }
+
+    /// The number of reports per second that a source may send, or zero if reports
+    /// are not limited.
+    unsigned int rate;
+    /// The number of reports that a source may send at once.
+    unsigned int burst;
+    /// The largest number of sources that have a bucket.
+    int max_sources;
+
+    /// The token bucket of every source that has sent reports recently.
+    IPAddressMap<IgmpReportBucket> buckets;
+
+    /// The number of drops of sources whose buckets were pruned or evicted.
+    uint64_t pruned_drops;
+    /// The number of buckets at which buckets are pruned.
+    int prune_limit;
+};
+
+CLICK_ENDDECLS
@@ -2,10 +2,8 @@
 
 #include <click/config.h>
 #include <click/element.hh>
-#include "CallbackTimer.hh"
-#include "EventSchedule.hh"
-#include "IgmpMessageManip.hh"
-#include "IgmpRouterFilter.hh"
+#include "IgmpForwardingCache.hh"
+#include "IgmpRouterInterface.hh"
 
 CLICK_DECLS
 
@@ -34,81 +32,75 @@ class IgmpRouter : public Element
     //         2. Incoming IP packets which were filtered out. The router does
     //            not believe that these are multicast packets intended for a
     //            client on the network.
+    //
+    //         3. Incoming IGMP membership reports which were over their source's
+    //            rate limit. Dropped if not connected.
+
+    // Configuration keywords:
+    //
+    //     ADDRESS: the router's IP address. Mandatory.
+    //
+    //     SSM_RANGE: the range of group addresses that are used for source-specific
+    //         multicast, as an IP prefix. Reports with EXCLUDE-mode records for
+    //         these groups are ignored. Defaults to 232.0.0.0/8.
+    //
+    //     MAX_GROUPS: the largest number of groups that the router keeps state
+    //         for. Records for new groups beyond this limit are ignored.
+    //
+    //     MAX_SOURCES_PER_GROUP: the largest number of sources, included or
+    //         excluded, that the router keeps state for per group.
+    //
+    //     MAX_SOURCE_RECORDS: the largest number of source records, over all
+    //         groups.
+    //
+    //     OVERFLOW_POLICY: what to do with a group record that would exceed one
+    //         of the source limits. 'reject' ignores the record; 'exclude'
+    //         switches the group to EXCLUDE({}), which forwards all sources.
+    //         Defaults to 'reject'.
+    //
+    //     REPORT_RATE: the number of membership reports per second that the
+    //         router accepts from each source address. Reports are limited
+    //         before they are parsed.
+    //
+    //     REPORT_BURST: the number of membership reports that a source may send
+    //         at once before REPORT_RATE kicks in. Defaults to REPORT_RATE.
+    //
+    //     REPORT_SOURCES: the largest number of sources that the report rate
+    //         limiter keeps track of. Beyond that, the sources that reported least
+    //         recently are forgotten, and start over with a full burst. Defaults
+    //         to 4096.
+    //
+    // The limits default to zero, which means that there is no limit. The
+    // group_limit_hits, group_source_limit_hits and source_record_limit_hits
+    // handlers count how often each limit was hit. The report_drops handler
+    // lists the number of reports that were dropped per source, and the
+    // total_report_drops handler counts them over all sources.
 
     const char *class_name() const { return "IgmpRouter"; }
-    const char *port_count() const { return "2/3"; }
+    const char *port_count() const { return "2/3-4"; }
     const char *processing() const { return PUSH; }
 
     int configure(Vector<String> &, ErrorHandler *);
 
     static int config(const String &conf, Element *e, void *thunk, ErrorHandler *errh);
+    static String pool_stats(Element *e, void *thunk);
+    static String group_record_count(Element *e, void *thunk);
+    static String limit_hits(Element *e, void *thunk);
+    static String report_drops(Element *e, void *thunk);
 
     void add_handlers();
 
     void push(int port, Packet *packet);
 
   private:
-    /// A timer callback that sends periodic general queries.
-    struct SendPeriodicGeneralQuery
-    {
-        SendPeriodicGeneralQuery()
-            : elem(nullptr)
-        {
-        }
-        SendPeriodicGeneralQuery(IgmpRouter *elem)
-            : elem(elem)
-        {
-        }
-        IgmpRouter *elem;
-
-        void operator()() const;
-    };
-
-    /// A timer callback that sends a group-specific query.
-    struct SendGroupSpecificQuery
-    {
-        SendGroupSpecificQuery()
-            : elem(nullptr), group_address()
-        {
-        }
-        SendGroupSpecificQuery(IgmpRouter *elem, const IPAddress &group_address)
-            : elem(elem), group_address(group_address)
-        {
-        }
-        IgmpRouter *elem;
-        IPAddress group_address;
-
-        void operator()() const;
-    };
-
-    /// A timer callback for the other querier present timer.
-    struct OtherQuerierGone
-    {
-        OtherQuerierGone()
-            : elem(nullptr)
-        {
-        }
-        OtherQuerierGone(IgmpRouter *elem)
-            : elem(elem)
-        {
-        }
-        IgmpRouter *elem;
-
-        void operator()() const;
-    };
-
-    void handle_igmp_packet(Packet *packet);
-    void handle_igmp_membership_query(const IgmpMembershipQuery &query, const IPAddress &source_address);
-    void transmit_membership_query(const IgmpMembershipQuery &query);
-    void init_startup_queries();
-
-    IPAddress address;
-    IgmpRouterFilter filter;
-    EventSchedule<SendGroupSpecificQuery> query_schedule;
-    CallbackTimer<SendPeriodicGeneralQuery> general_query_timer;
-    unsigned int startup_general_queries_remaining;
-    bool other_querier_present = false;
-    CallbackTimer<OtherQuerierGone> other_querier_present_timer;
+    /// Tests if packets from the given source to the given multicast address are
+    /// forwarded, consulting the forwarding cache first.
+    bool is_forwarded(const IPAddress &multicast_address, const IPAddress &source_address);
+
+    /// The router's only interface, which pushes its queries out of output 0.
+    IgmpRouterInterface interface;
+    /// Caches the filter's forwarding decisions for data packets.
+    IgmpForwardingCache<bool> forwarding_cache;
 };
 
 CLICK_ENDDECLS
\ No newline at end of file
@@ -2,70 +2,64 @@
 
 #include <click/config.h>
 #include <click/element.hh>
-#include <click/hashmap.hh>
 #include <click/vector.hh>
 #include <click/timer.hh>
 #include <clicknet/ip.h>
 #include "CallbackTimer.hh"
+#include "EventSchedule.hh"
+#include "IPAddressMap.hh"
 #include "IgmpMessage.hh"
 #include "IgmpMemberFilter.hh"
 #include "IgmpRouterVariables.hh"
+#include "IgmpSourceListTable.hh"
+#include "IgmpSourceSet.hh"
+#include "IgmpSsmChannelTable.hh"
+#include "SlabPool.hh"
+#include "SmallVector.hh"
 
 CLICK_DECLS
 
 class IgmpRouterFilter;
+struct IgmpRouterFilterRecord;
 
-/// A callback for source record timers.
-class IgmpRouterSourceRecordCallback final
+/// A callback that sweeps the expired source records of a single group record, or
+/// the expired SSM channels of a router filter if it has no group record.
+class IgmpRouterSourceSweepCallback final
 {
   public:
-    IgmpRouterSourceRecordCallback(const IPAddress &multicast_address, const IPAddress &source_address, IgmpRouterFilter *filter)
-        : multicast_address(multicast_address), source_address(source_address), filter(filter)
+    IgmpRouterSourceSweepCallback()
+        : filter(nullptr), record(nullptr)
+    {
+    }
+
+    IgmpRouterSourceSweepCallback(IgmpRouterFilter *filter, IgmpRouterFilterRecord *record)
+        : filter(filter), record(record)
     {
     }
 
     void operator()() const;
 
   private:
-    IPAddress multicast_address;
-    IPAddress source_address;
     IgmpRouterFilter *filter;
+    IgmpRouterFilterRecord *record;
 };
 
-/// Represents an IGMP source record in a router group record.
-class IgmpRouterSourceRecord final
+/// The state of a pending source sweep.
+struct IgmpRouterSourceSweep
 {
-  public:
-    IgmpRouterSourceRecord(const IPAddress &multicast_address, const IPAddress &source_address, IgmpRouterFilter *filter)
-        : source_address(source_address), timer(multicast_address, source_address, filter)
-    {
-    }
-
-    IPAddress get_source_address() const { return source_address; }
+    typedef EventSchedule<IgmpRouterSourceSweepCallback>::handle_type handle_type;
 
-    void initialize(Element *owner)
+    IgmpRouterSourceSweep()
+        : scheduled(false), expiry(), handle(0)
     {
-        timer.initialize(owner);
     }
 
-    void schedule_after_sec(uint32_t delta_sec)
-    {
-        timer.schedule_after_sec(delta_sec);
-    }
-
-    void schedule_after_msec(uint32_t delta_msec)
-    {
-        timer.schedule_after_msec(delta_msec);
-    }
-
-    void schedule_after_dsec(uint32_t delta_dsec)
-    {
-        schedule_after_msec(delta_dsec * 100);
-    }
-
-  private:
-    IPAddress source_address;
-    CallbackTimer<IgmpRouterSourceRecordCallback> timer;
+    /// Tells if a sweep is pending.
+    bool scheduled;
+    /// The time at which the sweep fires.
+    Timestamp expiry;
+    /// The sweep's handle in its filter's schedule.
+    handle_type handle;
 };
 
 /// A callback that converts group records in exclude mode to group records
@@ -74,25 +68,61 @@ class IgmpRouterGroupRecordCallback final
 {
   public:
     IgmpRouterGroupRecordCallback()
-        : multicast_address(), filter(nullptr)
+        : record(nullptr), filter(nullptr)
     {
     }
 
-    IgmpRouterGroupRecordCallback(const IPAddress &multicast_address, IgmpRouterFilter *filter)
-        : multicast_address(multicast_address), filter(filter)
+    IgmpRouterGroupRecordCallback(IgmpRouterFilterRecord *record, IgmpRouterFilter *filter)
+        : record(record), filter(filter)
     {
     }
 
     void operator()() const;
 
   private:
-    IPAddress multicast_address;
+    IgmpRouterFilterRecord *record;
     IgmpRouterFilter *filter;
 };
 
-/// A record in an IGMP router filter.
+/// A record in an IGMP router filter. Records are allocated from their filter's
+/// record pool and never move, so their timers can refer to them directly.
+///
+/// A record's source records are stored as a structure of arrays: an interned list
+/// of source addresses, which is shared with every other group record that has the
+/// same sources, and a parallel array of the times at which the source records
+/// expire. Source records do not own a timer. Expired source records are treated as
+/// absent. Each group record has a single pending source sweep, which fires when its
+/// earliest source record expires and then removes all of its expired source
+/// records at once. The sources of a report all expire at the same time, so that
+/// takes one sweep per report rather than one per source.
+///
+/// The forwarding state (the filter mode, the source addresses and the excluded
+/// addresses) comes first, so a forwarding decision only reads the start of the
+/// record and its source list, plus the expiry time of the source record it finds,
+/// if any. Timer state comes last.
 struct IgmpRouterFilterRecord
 {
+    /// The type of a group record's timer.
+    typedef CallbackTimer<IgmpRouterGroupRecordCallback> timer_type;
+
+    /// The type of a group record's array of source record expiry times. Like source
+    /// sets, short arrays are stored inline.
+    typedef SmallVector<Timestamp, IgmpSourceSet::inline_capacity> expiry_list;
+
+    IgmpRouterFilterRecord(IgmpRouterFilter *filter, timer_type::pool_type *timer_pool)
+        : filter_mode(IgmpFilterMode::Include),
+          source_addresses(nullptr),
+          excluded_addresses(),
+          source_expiries(),
+          source_sweep(),
+          multicast_address(),
+          timer(timer_type::allocate_in(*timer_pool, this, filter))
+    {
+    }
+
+    IgmpRouterFilterRecord(const IgmpRouterFilterRecord &) = delete;
+    IgmpRouterFilterRecord &operator=(const IgmpRouterFilterRecord &) = delete;
+
     // The spec on this data structure:
     //
     // When a router filter-mode for a group is EXCLUDE, the source record
@@ -109,165 +139,819 @@ struct IgmpRouterFilterRecord
     /// The filter record's mode.
     IgmpFilterMode filter_mode;
 
-    /// The filter record's timer.
-    CallbackTimer<IgmpRouterGroupRecordCallback> timer;
+    /// The addresses of the filter record's source records, sorted by source address.
+    /// This list is interned by the filter's source list table, which counts this
+    /// reference to it.
+    const IgmpSourceList *source_addresses;
+
+    /// The filter record's set of excluded addresses.
+    /// This set must be empty if the filter mode is INCLUDE.
+    IgmpSourceSet excluded_addresses;
 
-    /// The filter record's list of source addresses and their timers.
-    Vector<IgmpRouterSourceRecord> source_records;
+    /// The times at which the filter record's source records expire, in the same
+    /// order as 'source_addresses'.
+    expiry_list source_expiries;
 
-    /// The filter record's list of excluded addresses.
-    /// This list must be empty if the filter mode is INCLUDE.
-    Vector<IPAddress> excluded_addresses;
+    /// The pending sweep of the filter record's source records, if any.
+    IgmpRouterSourceSweep source_sweep;
+
+    /// The multicast address that the filter record is stored under.
+    IPAddress multicast_address;
 
-    /// Gets a list of all source addresses.
-    Vector<IPAddress> get_source_addresses() const
+    /// The filter record's timer.
+    timer_type timer;
+
+    /// Gets the number of source records.
+    int get_source_record_count() const
+    {
+        return source_addresses->size();
+    }
+
+    /// Makes the given interned list this record's list of source addresses, taking
+    /// over the caller's reference to it, and drops the reference to the old list.
+    void set_source_addresses(IgmpSourceListTable &source_lists, const IgmpSourceList *addresses)
     {
-        Vector<IPAddress> results;
-        for (const auto &item : source_records)
+        if (source_addresses != nullptr)
         {
-            results.push_back(item.get_source_address());
+            source_lists.release(source_addresses);
         }
-        return results;
+        source_addresses = addresses;
     }
 
-    /// Erases all source records which match the given predicate. A Boolean
-    /// result tells if any source records were actually erased.
-    template <typename TPredicate>
-    bool erase_source_records(const TPredicate &predicate)
+    /// Removes all source records.
+    void clear_source_records(IgmpSourceListTable &source_lists)
     {
-        bool erased_any = false;
-        size_t i = 0;
-        while (i < source_records.size())
+        set_source_addresses(source_lists, source_lists.acquire_empty());
+        source_expiries.clear();
+    }
+
+    /// Sets the excluded addresses to the addresses in the given set that do not have
+    /// a source record. This is a single merge pass over the set and the source
+    /// records, which reuses the excluded set's storage.
+    void exclude_unrecorded_sources(const IgmpSourceSet &addresses)
+    {
+        const auto &recorded_addresses = *source_addresses;
+        excluded_addresses.clear();
+        excluded_addresses.reserve(addresses.size());
+        int index = 0;
+        for (const auto &address : addresses)
         {
-            if (predicate(source_records[i]))
+            uint32_t key = igmp_source_key(address);
+            while (index < recorded_addresses.size() && igmp_source_key(recorded_addresses[index]) < key)
             {
-                source_records.erase(source_records.begin() + i);
-                erased_any = true;
+                index++;
             }
-            else
+            if (index == recorded_addresses.size() || recorded_addresses[index] != address)
             {
-                i++;
+                excluded_addresses.append_sorted(address);
             }
         }
-        return erased_any;
     }
+
+    /// Finds the position of the source record for the given address, or returns -1
+    /// if there is no such record.
+    int find_source_record(const IPAddress &source_address) const
+    {
+        return source_addresses->find(source_address);
+    }
+};
+
+/// 232.0.0.0/8, the range of group addresses that IANA has set aside for
+/// source-specific multicast (SSM). This is the default SSM range of router filters.
+const IPAddress default_ssm_prefix("232.0.0.0");
+const IPAddress default_ssm_mask("255.0.0.0");
+
+/// Checks an SSM range as it appears in a configuration string. The prefix is
+/// masked, so that it is the first address in the range. Returns false if the range
+/// is not a range of multicast addresses.
+inline bool normalize_igmp_ssm_range(IPAddress &prefix, const IPAddress &mask)
+{
+    // Both ends of the range must be multicast addresses.
+    prefix = IPAddress(prefix.addr() & mask.addr());
+    return prefix.is_multicast() && IPAddress(prefix.addr() | ~mask.addr()).is_multicast();
+}
+
+/// What a router filter does with a group record that would take a group past one of
+/// the filter's source limits.
+enum class IgmpOverflowPolicy
+{
+    /// Ignore the group record. The group keeps its current state.
+    Reject,
+    /// Switch the group to EXCLUDE({}), which forwards traffic from all sources and
+    /// takes no per-source state at all.
+    Exclude
+};
+
+/// Parses an overflow policy as it appears in a configuration string: 'reject' or
+/// 'exclude'. Returns false if the string names neither.
+inline bool parse_igmp_overflow_policy(const String &name, IgmpOverflowPolicy &policy)
+{
+    if (name == "reject")
+        policy = IgmpOverflowPolicy::Reject;
+    else if (name == "exclude")
+        policy = IgmpOverflowPolicy::Exclude;
+    else
+        return false;
+    return true;
+}
+
+/// Limits on the state that a router filter keeps, so a misbehaving host cannot make
+/// it grow without bounds. A limit of zero means that there is no limit.
+struct IgmpRouterLimits
+{
+    /// The largest number of group records. Records for new groups are rejected
+    /// once the filter has this many, regardless of the overflow policy.
+    unsigned int max_groups = 0;
+
+    /// The largest number of sources per group: source records plus excluded
+    /// addresses.
+    unsigned int max_sources_per_group = 0;
+
+    /// The largest number of source records over all groups, SSM channels included.
+    unsigned int max_source_records = 0;
+
+    /// What to do with group records that hit one of the source limits. SSM groups
+    /// have no EXCLUDE mode, so their records are always rejected.
+    IgmpOverflowPolicy overflow_policy = IgmpOverflowPolicy::Reject;
+};
+
+/// Counts the group records that hit one of a router filter's limits.
+struct IgmpRouterLimitCounters
+{
+    /// The number of records for new groups that were rejected by 'max_groups'.
+    uint64_t group_limit_hits = 0;
+
+    /// The number of records that hit 'max_sources_per_group'.
+    uint64_t group_source_limit_hits = 0;
+
+    /// The number of records that hit 'max_source_records'.
+    uint64_t source_record_limit_hits = 0;
 };
 
 /// A router "filter" for IGMP packets. It decides which addresses are listened to and which are not.
+///
+/// Groups in the filter's source-specific multicast (SSM) range are handled apart from
+/// other groups. Hosts only ever ask for specific (source, group) channels of an SSM
+/// group, so SSM groups have neither a group record nor a group timer. Instead, each
+/// channel that a host has asked for is an entry in an exact-match table, along with
+/// the time at which it expires.
 class IgmpRouterFilter
 {
   public:
     IgmpRouterFilter(Element *owner, bool enable_timers)
-        : owner(owner), enable_timers(enable_timers)
+        : owner(owner), enable_timers(enable_timers),
+          ssm_prefix(default_ssm_prefix), ssm_mask(default_ssm_mask),
+          generation(1), source_sweeps(owner)
     {
     }
 
     const IgmpRouterVariables &get_router_variables() const { return vars; }
     IgmpRouterVariables &get_router_variables() { return vars; }
 
+    const IgmpRouterLimits &get_limits() const { return limits; }
+    IgmpRouterLimits &get_limits() { return limits; }
+
+    /// Gets the number of times that this filter's limits have been hit.
+    const IgmpRouterLimitCounters &get_limit_counters() const { return limit_counters; }
+
+    /// Gets this filter's generation. The generation changes whenever the answers of
+    /// 'is_listening_to' may change for reasons other than the passage of time, so
+    /// it can be used to tag cached forwarding decisions.
+    uint64_t get_generation() const { return generation; }
+
+    /// Changes this filter's generation, which marks all cached forwarding decisions
+    /// as stale.
+    void invalidate_decisions() { generation++; }
+
     /// Gets a pointer to the record for the given multicast address.
     IgmpRouterFilterRecord *get_record(const IPAddress &multicast_address)
     {
-        return records.findp(multicast_address);
+        auto record_ptr = records.findp(multicast_address);
+        return record_ptr == nullptr ? nullptr : *record_ptr;
     }
 
     /// Gets a pointer to the record for the given multicast address.
     const IgmpRouterFilterRecord *get_record(const IPAddress &multicast_address) const
     {
-        return records.findp(multicast_address);
+        auto record_ptr = records.findp(multicast_address);
+        return record_ptr == nullptr ? nullptr : *record_ptr;
+    }
+
+    /// Sets the range of group addresses that are treated as SSM groups. This removes
+    /// all records and channels from this filter.
+    void set_ssm_range(const IPAddress &prefix, const IPAddress &mask)
+    {
+        clear();
+        ssm_prefix = IPAddress(prefix.addr() & mask.addr());
+        ssm_mask = mask;
+    }
+
+    /// Tests if the given group address is in this filter's SSM range.
+    bool is_ssm_group(const IPAddress &multicast_address) const
+    {
+        return (multicast_address.addr() & ssm_mask.addr()) == ssm_prefix.addr();
+    }
+
+    /// Removes all records from this filter. Their memory is reclaimed all at once.
+    void clear()
+    {
+        records.clear();
+        record_pool.clear();
+        source_lists.clear();
+        ssm_channels.clear();
+        source_sweeps.clear();
+        ssm_sweep = IgmpRouterSourceSweep();
+        invalidate_decisions();
+    }
+
+    /// Gets the number of group records in this filter.
+    int get_live_record_count() const
+    {
+        return record_pool.size();
+    }
+
+    /// Gets the number of group records that this filter has allocated, including
+    /// records that have been erased and wait to be recycled.
+    int get_allocated_record_count() const
+    {
+        return record_pool.size() + record_pool.free_count();
     }
 
-    /// Gets or creates a source record in the given group record.
-    IgmpRouterSourceRecord &get_or_create_source_record(
+    /// Describes the usage of this filter's memory pools.
+    String get_pool_stats() const
+    {
+        return "group records: " + record_pool.to_string() + "\n" +
+               "group timers: " + String(record_timer_pool.free_count()) + " free\n" +
+               "source lists: " + source_lists.to_string() + "\n" +
+               "ssm channels: " + ssm_channels.to_string() + "\n" +
+               "source sweeps: " + String(source_sweeps.size()) + " pending\n";
+    }
+
+    /// Merges a set of source addresses into the given group record's source records
+    /// in a single pass. Addresses that do not have a source record yet get one, with
+    /// its timer set to the GMI. Existing source records for addresses in the set have
+    /// their timers reset to the GMI if 'refresh_listed' is true. Source records for
+    /// addresses that are not in the set are kept if 'keep_unlisted' is true and
+    /// deleted otherwise.
+    void merge_source_records(
         IgmpRouterFilterRecord &group_record,
-        const IPAddress &multicast_address,
-        const IPAddress &source_address)
+        const IgmpSourceSet &source_addresses,
+        bool keep_unlisted,
+        bool refresh_listed)
     {
-        for (auto &record : group_record.source_records)
+        auto gmi_expiry = Timestamp::recent_steady() + Timestamp::make_msec(
+            get_router_variables().get_group_membership_interval() * 100);
+        const auto &old_addresses = *group_record.source_addresses;
+        const auto &old_expiries = group_record.source_expiries;
+        int old_count = old_addresses.size();
+
+        // The records are merged into scratch buffers. If the result fits in the
+        // group record's expiry array, which it does for short lists that are stored
+        // inline, then the merged expiry times are copied back. Otherwise, the buffer
+        // trades places with the group record's old expiry array. Either way, source
+        // record storage is recycled from one merge to the next. The merged addresses
+        // are only interned if they differ from the old ones, which they do not when
+        // a report merely refreshes a group's sources.
+        merge_addresses.clear();
+        merge_expiries.clear();
+        merge_addresses.reserve(old_count + source_addresses.size());
+        merge_expiries.reserve(old_count + source_addresses.size());
+
+        bool any_scheduled = false;
+        bool addresses_changed = false;
+        int old_index = 0;
+        auto new_it = source_addresses.begin();
+        while (old_index != old_count || new_it != source_addresses.end())
         {
-            if (record.get_source_address() == source_address)
+            if (new_it == source_addresses.end() ||
+                (old_index != old_count && igmp_source_less(old_addresses[old_index], *new_it)))
+            {
+                // An existing source record that is not in the set.
+                if (keep_unlisted)
+                {
+                    merge_addresses.push_back(old_addresses[old_index]);
+                    merge_expiries.push_back(old_expiries[old_index]);
+                }
+                else
+                {
+                    addresses_changed = true;
+                }
+                ++old_index;
+            }
+            else if (old_index == old_count || igmp_source_less(*new_it, old_addresses[old_index]))
+            {
+                // An address that does not have a source record yet.
+                merge_addresses.push_back(*new_it);
+                merge_expiries.push_back(gmi_expiry);
+                any_scheduled = true;
+                addresses_changed = true;
+                ++new_it;
+            }
+            else
             {
-                return record;
+                // An existing source record that is in the set.
+                merge_addresses.push_back(old_addresses[old_index]);
+                merge_expiries.push_back(refresh_listed ? gmi_expiry : old_expiries[old_index]);
+                any_scheduled |= refresh_listed;
+                ++old_index;
+                ++new_it;
             }
         }
 
-        group_record.source_records.push_back(
-            IgmpRouterSourceRecord(multicast_address, source_address, this));
-        auto &record = group_record.source_records[group_record.source_records.size() - 1];
-        if (enable_timers)
+        if (addresses_changed)
         {
-            record.initialize(owner);
+            group_record.set_source_addresses(source_lists, source_lists.intern(merge_addresses));
+        }
+        adopt_merged(group_record.source_expiries, merge_expiries);
+
+        if (any_scheduled)
+        {
+            schedule_source_sweep(group_record.source_sweep, &group_record, gmi_expiry);
         }
-        return record;
     }
 
+    /// Erases all source records of the given group record whose address is in the
+    /// given set if 'erase_members' is true, and all source records whose address is
+    /// not in the given set otherwise. This takes a single merge pass over the source
+    /// records and the set.
+    void erase_source_records(
+        IgmpRouterFilterRecord &group_record, const IgmpSourceSet &addresses, bool erase_members)
+    {
+        const auto &old_addresses = *group_record.source_addresses;
+        auto &expiries = group_record.source_expiries;
+        merge_addresses.clear();
+        auto address_it = addresses.begin();
+        for (int i = 0; i < old_addresses.size(); i++)
+        {
+            auto source_address = old_addresses[i];
+            uint32_t key = igmp_source_key(source_address);
+            while (address_it != addresses.end() && igmp_source_key(*address_it) < key)
+            {
+                ++address_it;
+            }
+            bool is_member = address_it != addresses.end() && *address_it == source_address;
+            if (is_member != erase_members)
+            {
+                expiries[merge_addresses.size()] = expiries[i];
+                merge_addresses.push_back(source_address);
+            }
+        }
+        if (merge_addresses.size() != old_addresses.size())
+        {
+            expiries.resize(merge_addresses.size());
+            group_record.set_source_addresses(source_lists, source_lists.intern(merge_addresses));
+        }
+    }
+
+    /// Tests if a source record that expires at the given time is live, i.e., if its
+    /// timer has not expired yet. Source records never expire if this filter's timers
+    /// are disabled.
+    bool is_live(const Timestamp &expiry, const Timestamp &now) const
+    {
+        return !enable_timers || now < expiry;
+    }
+
+    /// Removes all expired source records from the given group record in a single
+    /// compaction pass. If the group record is in EXCLUDE mode, then all expired
+    /// sources are moved to its set of excluded addresses at once. The group record's
+    /// source sweep is then rescheduled for its next source record to expire.
+    void sweep_source_records(IgmpRouterFilterRecord &record);
+
+    /// Removes all expired SSM channels and reschedules the SSM channel sweep for the
+    /// next channel to expire.
+    void sweep_ssm_channels();
+
     /// Creates a new record for the given multicast address, assigns the given filter
     /// mode to the newly-created record and returns it.
     IgmpRouterFilterRecord *create_record(const IPAddress &multicast_address, IgmpFilterMode filter_mode)
     {
         assert(get_record(multicast_address) == nullptr);
-        records.insert(multicast_address, IgmpRouterFilterRecord());
-        auto record_ptr = records.findp(multicast_address);
+
+        // Records may be recycled, so reset everything.
+        auto record_ptr = record_pool.acquire(this, &record_timer_pool);
         record_ptr->filter_mode = filter_mode;
-        if (enable_timers)
+        record_ptr->clear_source_records(source_lists);
+        record_ptr->excluded_addresses.clear();
+        record_ptr->source_sweep = IgmpRouterSourceSweep();
+        record_ptr->multicast_address = multicast_address;
+        if (enable_timers && !record_ptr->timer.initialized())
         {
-            record_ptr->timer = CallbackTimer<IgmpRouterGroupRecordCallback>(multicast_address, this);
             record_ptr->timer.initialize(owner);
         }
+        record_ptr->timer.unschedule();
+
+        records.insert(multicast_address, record_ptr);
         return record_ptr;
     }
 
+    /// Erases the given group record if it is in INCLUDE mode and has no source
+    /// records. Such a record does not forward anything, so it is no different from
+    /// having no record at all. A Boolean result tells if the record was erased.
+    ///
+    /// The record's timer is unscheduled, its pending source sweep is cancelled and
+    /// its source list is released. The record itself, along with its timer and
+    /// storage, goes back to the record pool to be recycled. The record must not be
+    /// used after it has been erased, but it may be erased from its own timer's
+    /// callback, because pooled records are not destroyed.
+    bool erase_record_if_empty(IgmpRouterFilterRecord &record)
+    {
+        if (record.filter_mode != IgmpFilterMode::Include || record.get_source_record_count() != 0)
+        {
+            return false;
+        }
+
+        records.erase(record.multicast_address);
+        record.timer.unschedule();
+        if (record.source_sweep.scheduled)
+        {
+            source_sweeps.cancel(record.source_sweep.handle);
+            record.source_sweep.scheduled = false;
+        }
+        record.set_source_addresses(source_lists, nullptr);
+        record.source_expiries.clear();
+        record_pool.release(&record);
+        return true;
+    }
+
     /// Receives a record that describes a multicast address' current state.
     void receive_current_state_record(const IPAddress &multicast_address, const IgmpFilterRecord &current_state_record);
 
     /// Tests if the IGMP filter is listening to the given source address for the given multicast
     /// address.
-    bool is_listening_to(const IPAddress &multicast_address, const IPAddress &source_address) const;
+    bool is_listening_to(const IPAddress &multicast_address, const IPAddress &source_address) const
+    {
+        Timestamp expiry;
+        return is_listening_to(multicast_address, source_address, expiry);
+    }
+
+    /// Tests if the filter is listening to packets from the given source address for
+    /// the given multicast address. If the answer depends on a source timer, then
+    /// 'expiry' is set to the time at which that timer expires; otherwise, 'expiry'
+    /// is left untouched. Until then, and as long as the filter's generation stays
+    /// the same, the answer does not change.
+    bool is_listening_to(const IPAddress &multicast_address, const IPAddress &source_address, Timestamp &expiry) const;
+
+    /// Tests if the filter forwards packets from the given source to the given group,
+    /// which must be in the SSM range. This is a single probe of the channel table.
+    /// 'expiry' is treated like it is by 'is_listening_to'.
+    bool is_listening_to_ssm_channel(
+        const IPAddress &multicast_address, const IPAddress &source_address, Timestamp &expiry) const
+    {
+        auto channel_expiry = ssm_channels.findp(multicast_address, source_address);
+        if (channel_expiry == nullptr)
+        {
+            return false;
+        }
+
+        bool live = is_live(*channel_expiry, Timestamp::recent_steady());
+        if (live && enable_timers)
+        {
+            expiry = *channel_expiry;
+        }
+        return live;
+    }
 
   private:
+    /// Receives a record for a group in the SSM range.
+    void receive_ssm_record(const IPAddress &multicast_address, const IgmpFilterRecord &current_state_record)
+    {
+        // RFC 4604 tells routers to ignore EXCLUDE-mode records for SSM groups: SSM
+        // only delivers traffic from the sources that a host asks for by name.
+        if (current_state_record.filter_mode == IgmpFilterMode::Exclude ||
+            !admit_ssm_channels(multicast_address, current_state_record))
+        {
+            return;
+        }
+
+        // An INCLUDE record starts or refreshes the channels for its sources. The
+        // channels for other sources are left to expire, just like the source records
+        // of a group record in INCLUDE mode.
+        auto gmi_expiry = Timestamp::recent_steady() + Timestamp::make_msec(
+            get_router_variables().get_group_membership_interval() * 100);
+        for (const auto &source_address : current_state_record.source_addresses)
+        {
+            ssm_channels.insert(multicast_address, source_address, gmi_expiry);
+        }
+
+        if (!current_state_record.source_addresses.empty())
+        {
+            schedule_source_sweep(ssm_sweep, nullptr, gmi_expiry);
+        }
+    }
+
+    /// Makes a group record's expiry array take the contents of a scratch array that
+    /// a merge has filled. See 'merge_source_records'.
+    static void adopt_merged(IgmpRouterFilterRecord::expiry_list &target, IgmpRouterFilterRecord::expiry_list &merged)
+    {
+        if (merged.size() <= target.capacity())
+        {
+            target = merged;
+        }
+        else
+        {
+            target.swap(merged);
+        }
+    }
+
+    /// Makes sure that a source sweep runs no later than the given time. The sweep
+    /// sweeps the given group record, or the SSM channels if the record is null.
+    void schedule_source_sweep(IgmpRouterSourceSweep &sweep, IgmpRouterFilterRecord *record, const Timestamp &expiry)
+    {
+        if (!enable_timers || (sweep.scheduled && !(expiry < sweep.expiry)))
+        {
+            return;
+        }
+
+        if (sweep.scheduled)
+        {
+            source_sweeps.cancel(sweep.handle);
+        }
+        sweep.handle = source_sweeps.schedule_at_steady(expiry, IgmpRouterSourceSweepCallback(this, record));
+        sweep.expiry = expiry;
+        sweep.scheduled = true;
+    }
+
+    /// Tests if applying a current-state record to the given group record keeps the
+    /// group within this filter's source limits, and counts the limit that is hit if
+    /// it does not. This predicts the size of the group's new state from the router
+    /// state tables in a merge pass over the report's sources, without changing the
+    /// group record.
+    bool admit_sources(const IgmpRouterFilterRecord &record, const IgmpFilterRecord &current_state_record)
+    {
+        if (limits.max_sources_per_group == 0 && limits.max_source_records == 0)
+        {
+            return true;
+        }
+
+        const auto &report_addresses = current_state_record.source_addresses;
+        const auto &recorded_addresses = *record.source_addresses;
+        int report_count = report_addresses.size();
+        int recorded_count = recorded_addresses.size();
+        int new_recorded_count;
+        int new_source_count;
+        if (current_state_record.filter_mode == IgmpFilterMode::Exclude)
+        {
+            // INCLUDE (A)   IS_EX (B) -> EXCLUDE (A*B, B-A)
+            // EXCLUDE (X,Y) IS_EX (A) -> EXCLUDE (A-Y, Y*A)
+            //
+            // Either way, every reported source ends up in exactly one of the two sets.
+            if (record.filter_mode == IgmpFilterMode::Include)
+            {
+                new_recorded_count = igmp_count_common_sources(
+                    recorded_addresses.begin(), recorded_count, report_addresses.begin(), report_count);
+            }
+            else
+            {
+                new_recorded_count = report_count - igmp_count_common_sources(
+                    record.excluded_addresses.begin(), record.excluded_addresses.size(),
+                    report_addresses.begin(), report_count);
+            }
+            new_source_count = report_count;
+        }
+        else
+        {
+            // INCLUDE (A)   IS_IN (B) -> INCLUDE (A+B)
+            // EXCLUDE (X,Y) IS_IN (A) -> EXCLUDE (X+A, Y-A)
+            new_recorded_count = recorded_count + report_count - igmp_count_common_sources(
+                recorded_addresses.begin(), recorded_count, report_addresses.begin(), report_count);
+            new_source_count = new_recorded_count + record.excluded_addresses.size() -
+                igmp_count_common_sources(
+                    record.excluded_addresses.begin(), record.excluded_addresses.size(),
+                    report_addresses.begin(), report_count);
+        }
+
+        if (limits.max_sources_per_group != 0 && (unsigned int)new_source_count > limits.max_sources_per_group)
+        {
+            limit_counters.group_source_limit_hits++;
+            return false;
+        }
+
+        int new_total = source_lists.get_referenced_address_count() + ssm_channels.size() +
+            new_recorded_count - recorded_count;
+        if (limits.max_source_records != 0 && new_recorded_count > recorded_count &&
+            (unsigned int)new_total > limits.max_source_records)
+        {
+            limit_counters.source_record_limit_hits++;
+            return false;
+        }
+        return true;
+    }
+
+    /// Tests if an INCLUDE record for an SSM group keeps this filter within its
+    /// source limits, and counts the limit that is hit if it does not.
+    bool admit_ssm_channels(const IPAddress &multicast_address, const IgmpFilterRecord &current_state_record)
+    {
+        const auto &source_addresses = current_state_record.source_addresses;
+        if (limits.max_sources_per_group != 0 &&
+            (unsigned int)source_addresses.size() > limits.max_sources_per_group)
+        {
+            limit_counters.group_source_limit_hits++;
+            return false;
+        }
+
+        if (limits.max_source_records == 0)
+        {
+            return true;
+        }
+
+        int new_channel_count = 0;
+        for (const auto &source_address : source_addresses)
+        {
+            if (ssm_channels.findp(multicast_address, source_address) == nullptr)
+            {
+                new_channel_count++;
+            }
+        }
+        int new_total = source_lists.get_referenced_address_count() + ssm_channels.size() + new_channel_count;
+        if (new_channel_count > 0 && (unsigned int)new_total > limits.max_source_records)
+        {
+            limit_counters.source_record_limit_hits++;
+            return false;
+        }
+        return true;
+    }
+
+    /// Switches a group record to EXCLUDE({}), which drops all of its per-source state.
+    /// This is the 'Exclude' overflow policy.
+    void collapse_to_exclude(IgmpRouterFilterRecord &record)
+    {
+        record.filter_mode = IgmpFilterMode::Exclude;
+        record.clear_source_records(source_lists);
+        record.excluded_addresses.clear();
+        record.timer.schedule_after_dsec(get_router_variables().get_group_membership_interval());
+    }
+
     Element *owner;
     IgmpRouterVariables vars;
+    IgmpRouterLimits limits;
+    IgmpRouterLimitCounters limit_counters;
     bool enable_timers;
-    HashMap<IPAddress, IgmpRouterFilterRecord> records;
+    IPAddressMap<IgmpRouterFilterRecord *> records;
+
+    /// The pool that group records' timers are allocated from. The timers of records
+    /// that are destroyed by 'clear' go back to this pool, so it must outlive the
+    /// record pool.
+    IgmpRouterFilterRecord::timer_type::pool_type record_timer_pool;
+
+    /// The pool that group records are allocated from.
+    SlabPool<IgmpRouterFilterRecord> record_pool;
+
+    /// The table that interns group records' source lists.
+    IgmpSourceListTable source_lists;
+
+    /// The range of group addresses that are SSM groups.
+    IPAddress ssm_prefix;
+    IPAddress ssm_mask;
+
+    /// The channels of SSM groups.
+    IgmpSsmChannelTable ssm_channels;
+
+    /// Scratch buffers for 'merge_source_records'. The address buffer is also used
+    /// by 'erase_source_records' and the source sweep.
+    IgmpSourceList::address_list merge_addresses;
+    IgmpRouterFilterRecord::expiry_list merge_expiries;
+
+    /// A scratch set for the source differences that 'receive_current_state_record'
+    /// computes.
+    IgmpSourceSet difference_buffer;
+
+    /// The filter's generation. See 'get_generation'.
+    uint64_t generation;
+
+    /// The pending source sweeps: one per group record that has source records, plus
+    /// one for the SSM channels.
+    EventSchedule<IgmpRouterSourceSweepCallback> source_sweeps;
+
+    /// The pending sweep of the SSM channels, if any.
+    IgmpRouterSourceSweep ssm_sweep;
+
+    /// A scratch set for the addresses of expired source records.
+    IgmpSourceSet expired_addresses;
 };
 
-inline void IgmpRouterSourceRecordCallback::operator()() const
+inline void IgmpRouterSourceSweepCallback::operator()() const
 {
-    auto record_ptr = filter->get_record(multicast_address);
-    if (record_ptr == nullptr)
+    if (filter == nullptr)
     {
         return;
     }
 
-    bool erased_any = record_ptr->erase_source_records(
-        [=](const IgmpRouterSourceRecord &source_record) {
-            return source_record.get_source_address() == source_address;
-        });
-
-    if (erased_any && record_ptr->filter_mode == IgmpFilterMode::Exclude)
+    if (record == nullptr)
+    {
+        filter->sweep_ssm_channels();
+    }
+    else
     {
-        record_ptr->excluded_addresses.push_back(source_address);
+        filter->sweep_source_records(*record);
     }
 }
 
-inline void IgmpRouterGroupRecordCallback::operator()() const
+inline void IgmpRouterFilter::sweep_source_records(IgmpRouterFilterRecord &record)
 {
-    if (filter == nullptr)
+    auto now = Timestamp::recent_steady();
+    bool has_next_expiry = false;
+    Timestamp next_expiry;
+    record.source_sweep.scheduled = false;
+
+    // Compact the live source records and collect the expired ones, which are
+    // already sorted.
+    const auto &source_addresses = *record.source_addresses;
+    auto &source_expiries = record.source_expiries;
+    expired_addresses.clear();
+    merge_addresses.clear();
+    for (int i = 0; i < source_addresses.size(); i++)
+    {
+        auto expiry = source_expiries[i];
+        if (!(now < expiry))
+        {
+            expired_addresses.append_sorted(source_addresses[i]);
+            continue;
+        }
+
+        if (!has_next_expiry || expiry < next_expiry)
+        {
+            next_expiry = expiry;
+            has_next_expiry = true;
+        }
+        source_expiries[merge_addresses.size()] = expiry;
+        merge_addresses.push_back(source_addresses[i]);
+    }
+
+    if (has_next_expiry)
+    {
+        schedule_source_sweep(record.source_sweep, &record, next_expiry);
+    }
+
+    if (expired_addresses.empty())
     {
         return;
     }
 
-    auto record_ptr = filter->get_record(multicast_address);
-    if (record_ptr == nullptr)
+    source_expiries.resize(merge_addresses.size());
+    record.set_source_addresses(source_lists, source_lists.intern(merge_addresses));
+    invalidate_decisions();
+
+    // According to the spec:
+    //
+    //     Group
+    //     Filter-Mode    Source Timer Value    Action
+    //     -----------    ------------------    ------
+    //     INCLUDE        TIMER == 0            Suggest to stop forwarding
+    //                                          traffic from source and
+    //                                          remove source record. If
+    //                                          there are no more source
+    //                                          records for the group, delete
+    //                                          group record.
+    //
+    //     EXCLUDE        TIMER == 0            Suggest to not forward
+    //                                          traffic from source
+    //                                          (DO NOT remove record)
+    //
+    // We represent sources whose timers have expired in EXCLUDE mode by moving
+    // them to the set of excluded addresses.
+    if (record.filter_mode == IgmpFilterMode::Exclude)
+    {
+        record.excluded_addresses = union_source_sets(record.excluded_addresses, expired_addresses);
+    }
+    else
+    {
+        erase_record_if_empty(record);
+    }
+}
+
+inline void IgmpRouterFilter::sweep_ssm_channels()
+{
+    bool has_next_expiry = false;
+    Timestamp next_expiry;
+    ssm_sweep.scheduled = false;
+    if (ssm_channels.erase_expired(Timestamp::recent_steady(), next_expiry, has_next_expiry))
+    {
+        invalidate_decisions();
+    }
+
+    if (has_next_expiry)
+    {
+        schedule_source_sweep(ssm_sweep, nullptr, next_expiry);
+    }
+}
+
+inline void IgmpRouterGroupRecordCallback::operator()() const
+{
+    if (record == nullptr)
     {
         return;
     }
 
-    if (record_ptr->filter_mode == IgmpFilterMode::Exclude)
+    if (record->filter_mode == IgmpFilterMode::Exclude)
     {
-        record_ptr->filter_mode = IgmpFilterMode::Include;
-        record_ptr->excluded_addresses.clear();
+        record->filter_mode = IgmpFilterMode::Include;
+        record->excluded_addresses.clear();
+        filter->invalidate_decisions();
     }
+
+    // Once the group timer has expired, a group record without source records is
+    // dead weight.
+    filter->erase_record_if_empty(*record);
 }
 
 inline void IgmpRouterFilter::receive_current_state_record(
@@ -326,12 +1010,50 @@ inline void IgmpRouterFilter::receive_current_state_record(
     //                                                          Delete (Y-A)
     //                                                          Group Timer=GMI
 
+    // Every record can change which sources are forwarded, so cached forwarding
+    // decisions can no longer be trusted.
+    invalidate_decisions();
+
+    if (is_ssm_group(multicast_address))
+    {
+        receive_ssm_record(multicast_address, current_state_record);
+        return;
+    }
+
     auto record_ptr = get_record(multicast_address);
     if (record_ptr == nullptr)
     {
+        // A group without a record is in INCLUDE({}) mode, which IS_IN({}) leaves as
+        // it is.
+        if (current_state_record.filter_mode == IgmpFilterMode::Include &&
+            current_state_record.source_addresses.empty())
+        {
+            return;
+        }
+
+        if (limits.max_groups != 0 && (unsigned int)records.size() >= limits.max_groups)
+        {
+            limit_counters.group_limit_hits++;
+            return;
+        }
+
         record_ptr = create_record(multicast_address, IgmpFilterMode::Include);
     }
 
+    if (!admit_sources(*record_ptr, current_state_record))
+    {
+        if (limits.overflow_policy == IgmpOverflowPolicy::Exclude)
+        {
+            collapse_to_exclude(*record_ptr);
+        }
+        else
+        {
+            // A record that was just created for the rejected report is empty.
+            erase_record_if_empty(*record_ptr);
+        }
+        return;
+    }
+
     if (record_ptr->filter_mode == IgmpFilterMode::Include)
     {
         if (current_state_record.filter_mode == IgmpFilterMode::Include)
@@ -341,11 +1063,10 @@ inline void IgmpRouterFilter::receive_current_state_record(
             //
             //    INCLUDE (A)    IS_IN (B)     INCLUDE (A+B)            (B)=GMI
 
-            for (const auto &source_address : current_state_record.source_addresses)
-            {
-                auto &record = get_or_create_source_record(*record_ptr, multicast_address, source_address);
-                record.schedule_after_dsec(get_router_variables().get_group_membership_interval());
-            }
+            merge_source_records(*record_ptr, current_state_record.source_addresses, true, true);
+
+            // IS_IN({}) for a group without source records leaves nothing to keep.
+            erase_record_if_empty(*record_ptr);
         }
         else
         {
@@ -360,15 +1081,10 @@ inline void IgmpRouterFilter::receive_current_state_record(
             record_ptr->filter_mode = IgmpFilterMode::Exclude;
 
             // Set excluded addresses to B-A.
-            record_ptr->excluded_addresses = difference_vectors(
-                current_state_record.source_addresses, record_ptr->get_source_addresses());
+            record_ptr->exclude_unrecorded_sources(current_state_record.source_addresses);
 
             // Set source records to A*B by deleting all elements of A which are not in B.
-            record_ptr->erase_source_records([&current_state_record](const IgmpRouterSourceRecord &source_record) {
-                return !in_vector(
-                    source_record.get_source_address(),
-                    current_state_record.source_addresses);
-            });
+            erase_source_records(*record_ptr, current_state_record.source_addresses, false);
 
             // Set the group timer to the GMI.
             record_ptr->timer.schedule_after_dsec(get_router_variables().get_group_membership_interval());
@@ -383,14 +1099,9 @@ inline void IgmpRouterFilter::receive_current_state_record(
             //
             //    EXCLUDE (X,Y)  IS_IN (A)     EXCLUDE (X+A,Y-A)        (A)=GMI
 
-            record_ptr->excluded_addresses = difference_vectors(
-                record_ptr->excluded_addresses, current_state_record.source_addresses);
+            record_ptr->excluded_addresses.subtract(current_state_record.source_addresses);
 
-            for (const auto &source_address : current_state_record.source_addresses)
-            {
-                auto &record = get_or_create_source_record(*record_ptr, multicast_address, source_address);
-                record.schedule_after_dsec(get_router_variables().get_group_membership_interval());
-            }
+            merge_source_records(*record_ptr, current_state_record.source_addresses, true, true);
         }
         else
         {
@@ -402,36 +1113,14 @@ inline void IgmpRouterFilter::receive_current_state_record(
             //                                                          Delete (Y-A)
             //                                                          Group Timer=GMI
 
-            auto prev_source_addresses = record_ptr->get_source_addresses();
-
-            // Delete X-A from the source records by erasing all source records that are not
-            // in A. This nets us X-(X-A) = X*A.
-            record_ptr->erase_source_records([&current_state_record](const IgmpRouterSourceRecord &source_record) {
-                return !in_vector(
-                    source_record.get_source_address(),
-                    current_state_record.source_addresses);
-            });
-
-            // Now delete X*Y from the source records by erasing all source records that are
-            // in Y. This nets us X*A-(X*Y) = X*A - Y.
-            record_ptr->erase_source_records([record_ptr](const IgmpRouterSourceRecord &source_record) {
-                return in_vector(
-                    source_record.get_source_address(),
-                    record_ptr->excluded_addresses);
-            });
-
-            // Add A-X-Y to the source records and set their timers to the GMI.
-            for (const auto &source_address : difference_vectors(
-                     difference_vectors(current_state_record.source_addresses, prev_source_addresses),
-                     record_ptr->excluded_addresses))
-            {
-                auto &record = get_or_create_source_record(*record_ptr, multicast_address, source_address);
-                record.schedule_after_dsec(get_router_variables().get_group_membership_interval());
-            }
+            // Set the source records to A-Y in a single merge pass: X*A-Y keeps its
+            // timers, A-X-Y is added with its timers set to the GMI and everything
+            // else (X-A and X*Y) is deleted.
+            difference_buffer.assign_difference(current_state_record.source_addresses, record_ptr->excluded_addresses);
+            merge_source_records(*record_ptr, difference_buffer, false, false);
 
-            // Update the list of excluded addresses.
-            record_ptr->excluded_addresses = intersect_vectors(
-                record_ptr->excluded_addresses, current_state_record.source_addresses);
+            // Update the set of excluded addresses.
+            record_ptr->excluded_addresses.intersect(current_state_record.source_addresses);
 
             // Set the group timer to the GMI.
             record_ptr->timer.schedule_after_dsec(get_router_variables().get_group_membership_interval());
@@ -439,7 +1128,8 @@ inline void IgmpRouterFilter::receive_current_state_record(
     }
 }
 
-inline bool IgmpRouterFilter::is_listening_to(const IPAddress &multicast_address, const IPAddress &source_address) const
+inline bool IgmpRouterFilter::is_listening_to(
+    const IPAddress &multicast_address, const IPAddress &source_address, Timestamp &expiry) const
 {
     if (multicast_address == all_systems_multicast_address)
     {
@@ -462,6 +1152,10 @@ inline bool IgmpRouterFilter::is_listening_to(const IPAddress &multicast_address
         // perform the group member part of IGMPv3 for that address on that interface).
         return true;
     }
+    else if (is_ssm_group(multicast_address))
+    {
+        return is_listening_to_ssm_channel(multicast_address, source_address, expiry);
+    }
 
     const IgmpRouterFilterRecord *record_ptr = get_record(multicast_address);
     if (record_ptr == nullptr)
@@ -469,20 +1163,24 @@ inline bool IgmpRouterFilter::is_listening_to(const IPAddress &multicast_address
         return false;
     }
 
-    if (record_ptr->filter_mode == IgmpFilterMode::Exclude)
+    // Source records whose timers have expired are treated as if the source sweep
+    // had already processed them: they are absent in INCLUDE mode and excluded in
+    // EXCLUDE mode.
+    int source_index = record_ptr->find_source_record(source_address);
+    if (source_index >= 0)
     {
-        return !in_vector(source_address, record_ptr->excluded_addresses);
+        const auto &source_expiry = record_ptr->source_expiries[source_index];
+        bool live = is_live(source_expiry, Timestamp::recent_steady());
+        if (live && enable_timers)
+        {
+            expiry = source_expiry;
+        }
+        return live;
     }
     else
     {
-        for (const auto &item : record_ptr->source_records)
-        {
-            if (item.get_source_address() == source_address)
-            {
-                return true;
-            }
-        }
-        return false;
+        return record_ptr->filter_mode == IgmpFilterMode::Exclude &&
+               !record_ptr->excluded_addresses.contains(source_address);
     }
 }
 
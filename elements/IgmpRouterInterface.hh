@@ -0,0 +1,127 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/element.hh>
+#include "CallbackTimer.hh"
+#include "EventSchedule.hh"
+#include "IgmpMessageManip.hh"
+#include "IgmpMessageView.hh"
+#include "IgmpReportRateLimiter.hh"
+#include "IgmpRouterFilter.hh"
+
+CLICK_DECLS
+
+/// The router side of IGMP for a single network interface. An interface keeps the
+/// group state for its network, processes the IGMP messages that arrive on it and
+/// acts as the querier for its network.
+///
+/// Interfaces are not elements themselves: they are owned by an element, which hands
+/// them IGMP packets and pushes the queries they generate out of one of its output
+/// ports. An interface must not be moved once it has been created, because its timers
+/// refer to it.
+class IgmpRouterInterface final
+{
+  public:
+    /// Creates an interface that belongs to the given element. Queries are pushed
+    /// out of the given output port of that element.
+    IgmpRouterInterface(Element *owner, int query_port);
+
+    IgmpRouterInterface(const IgmpRouterInterface &) = delete;
+    IgmpRouterInterface &operator=(const IgmpRouterInterface &) = delete;
+
+    /// Assigns the interface's address and starts sending startup general queries.
+    /// This must be called when the owner is configured.
+    void start(const IPAddress &address);
+
+    /// Gets the interface's address.
+    const IPAddress &get_address() const { return address; }
+
+    /// Gets the interface's group state.
+    const IgmpRouterFilter &get_filter() const { return filter; }
+    IgmpRouterFilter &get_filter() { return filter; }
+
+    /// Gets the rate limiter for membership reports that arrive on this interface.
+    const IgmpReportRateLimiter &get_report_limiter() const { return report_limiter; }
+    IgmpReportRateLimiter &get_report_limiter() { return report_limiter; }
+
+    /// Tests if an IGMP packet may be handed to 'handle_igmp_packet', without parsing
+    /// it. Only membership reports whose source is over its rate limit are refused.
+    bool admit_igmp_packet(const Packet *packet);
+
+    /// Handles an IGMP packet that arrived on this interface. The packet's IP header
+    /// must already have been stripped; its IP header annotation must still be set.
+    /// The packet is consumed.
+    void handle_igmp_packet(Packet *packet);
+
+    /// Parses a configuration string that assigns router variables.
+    int configure_variables(const String &conf, ErrorHandler *errh);
+
+  private:
+    /// A timer callback that sends periodic general queries.
+    struct SendPeriodicGeneralQuery
+    {
+        SendPeriodicGeneralQuery()
+            : iface(nullptr)
+        {
+        }
+        SendPeriodicGeneralQuery(IgmpRouterInterface *iface)
+            : iface(iface)
+        {
+        }
+        IgmpRouterInterface *iface;
+
+        void operator()() const;
+    };
+
+    /// A timer callback that sends a group-specific query.
+    struct SendGroupSpecificQuery
+    {
+        SendGroupSpecificQuery()
+            : iface(nullptr), group_address()
+        {
+        }
+        SendGroupSpecificQuery(IgmpRouterInterface *iface, const IPAddress &group_address)
+            : iface(iface), group_address(group_address)
+        {
+        }
+        IgmpRouterInterface *iface;
+        IPAddress group_address;
+
+        void operator()() const;
+    };
+
+    /// A timer callback for the other querier present timer.
+    struct OtherQuerierGone
+    {
+        OtherQuerierGone()
+            : iface(nullptr)
+        {
+        }
+        OtherQuerierGone(IgmpRouterInterface *iface)
+            : iface(iface)
+        {
+        }
+        IgmpRouterInterface *iface;
+
+        void operator()() const;
+    };
+
+    void handle_igmp_membership_query(const IgmpMembershipQueryView &query, const IPAddress &source_address);
+    void transmit_membership_query(const IgmpMembershipQuery &query);
+    void init_startup_queries();
+
+    Element *owner;
+    int query_port;
+    IPAddress address;
+    IgmpRouterFilter filter;
+    IgmpReportRateLimiter report_limiter;
+    /// A scratch filter record for the group records in incoming reports.
+    IgmpFilterRecord report_record;
+    EventSchedule<SendGroupSpecificQuery> query_schedule;
+    CallbackTimer<SendPeriodicGeneralQuery> general_query_timer;
+    unsigned int startup_general_queries_remaining;
+    bool other_querier_present;
+    CallbackTimer<OtherQuerierGone> other_querier_present_timer;
+};
+
+CLICK_ENDDECLS
@@ -0,0 +1,268 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <clicknet/ip.h>
+#include "IgmpSourceSet.hh"
+#include "SlabPool.hh"
+#include "SmallVector.hh"
+
+CLICK_DECLS
+
+class IgmpSourceListTable;
+
+/// A sorted list of source addresses that is interned by an 'IgmpSourceListTable'.
+/// Every group record whose source records have the same addresses refers to the
+/// same list, so a set of sources that many groups have in common is stored once.
+///
+/// Interned lists never change. A group record whose sources change interns its new
+/// list and drops its reference to the old one.
+class IgmpSourceList final
+{
+  public:
+    /// The type of the address array that a list is made from.
+    typedef SmallVector<IPAddress, IgmpSourceSet::inline_capacity> address_list;
+
+    typedef const IPAddress *const_iterator;
+    typedef const_iterator iterator;
+
+    IgmpSourceList()
+        : ref_count(0), hash(0), next(nullptr), addresses()
+    {
+    }
+
+    IgmpSourceList(const IgmpSourceList &) = delete;
+    IgmpSourceList &operator=(const IgmpSourceList &) = delete;
+
+    /// Gets the number of addresses in this list.
+    int size() const { return addresses.size(); }
+
+    /// Tests if this list is empty.
+    bool empty() const { return addresses.empty(); }
+
+    /// Gets the address at the given position in this list.
+    const IPAddress &operator[](int index) const { return addresses[index]; }
+
+    const_iterator begin() const { return addresses.begin(); }
+    const_iterator end() const { return addresses.end(); }
+
+    /// Finds the position of the given address in this list, or returns -1 if the
+    /// address is not in the list.
+    int find(const IPAddress &address) const
+    {
+        return igmp_find_source(begin(), size(), address);
+    }
+
+    /// Tests if this list holds the same addresses as the given array.
+    bool equals(const address_list &other) const
+    {
+        if (size() != other.size())
+        {
+            return false;
+        }
+        for (int i = 0; i < size(); i++)
+        {
+            if (addresses[i] != other[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+  private:
+    friend class IgmpSourceListTable;
+
+    /// The number of group records that refer to this list, plus one for the empty
+    /// list, which its table keeps alive.
+    int ref_count;
+    /// The hash of the list's addresses.
+    uint32_t hash;
+    /// The next list in the same hash bucket.
+    IgmpSourceList *next;
+    /// The list's addresses, in ascending order.
+    address_list addresses;
+};
+
+/// Interns the source lists of a router filter's group records. The table counts
+/// the references to each list and recycles lists once nothing refers to them.
+///
+/// Lists are allocated from a slab pool, so recycled lists keep their address
+/// storage, and are found through a chained hash table with a per-table random
+/// seed, so that source lists cannot be crafted to collide.
+class IgmpSourceListTable final
+{
+  public:
+    IgmpSourceListTable()
+        : seed(((uint32_t)click_random() << 16) ^ (uint32_t)click_random()), count(0),
+          referenced_addresses(0), empty_list(nullptr)
+    {
+        reset();
+    }
+
+    IgmpSourceListTable(const IgmpSourceListTable &) = delete;
+    IgmpSourceListTable &operator=(const IgmpSourceListTable &) = delete;
+
+    /// Gets the number of distinct lists in this table.
+    int size() const { return count; }
+
+    /// Gets the sum of the sizes of all references to lists in this table. For a
+    /// router filter, that is the number of source records in all of its group
+    /// records.
+    int get_referenced_address_count() const { return referenced_addresses; }
+
+    /// Gets a new reference to the empty list.
+    const IgmpSourceList *acquire_empty()
+    {
+        empty_list->ref_count++;
+        return empty_list;
+    }
+
+    /// Gets a new reference to the list with the given addresses, which must be
+    /// sorted and free of duplicates. The list is created if it is not in the table.
+    const IgmpSourceList *intern(const IgmpSourceList::address_list &addresses)
+    {
+        uint32_t list_hash = hash(addresses);
+        for (auto list = buckets[list_hash & (buckets.size() - 1)]; list != nullptr; list = list->next)
+        {
+            if (list->hash == list_hash && list->equals(addresses))
+            {
+                list->ref_count++;
+                referenced_addresses += list->size();
+                return list;
+            }
+        }
+
+        // Recycled lists keep their storage, so this only allocates if the new list
+        // is longer than the recycled one.
+        auto list = pool.acquire();
+        list->ref_count = 1;
+        list->hash = list_hash;
+        list->addresses = addresses;
+        link(list);
+        count++;
+        referenced_addresses += list->size();
+        if (count > buckets.size())
+        {
+            rehash(2 * buckets.size());
+        }
+        return list;
+    }
+
+    /// Drops a reference to a list. The list is recycled if that was the last
+    /// reference to it.
+    void release(const IgmpSourceList *list)
+    {
+        auto mutable_list = const_cast<IgmpSourceList *>(list);
+        referenced_addresses -= list->size();
+        if (--mutable_list->ref_count != 0)
+        {
+            return;
+        }
+
+        auto link_ptr = &buckets[list->hash & (buckets.size() - 1)];
+        while (*link_ptr != list)
+        {
+            link_ptr = &(*link_ptr)->next;
+        }
+        *link_ptr = list->next;
+        mutable_list->next = nullptr;
+        count--;
+        pool.release(mutable_list);
+    }
+
+    /// Removes all lists from this table, whether they are referred to or not. Only
+    /// the empty list is recreated.
+    void clear()
+    {
+        pool.clear();
+        reset();
+    }
+
+    /// Describes this table's usage.
+    String to_string() const
+    {
+        return String(count) + " distinct, " + String(buckets.size()) + " buckets; " + pool.to_string();
+    }
+
+  private:
+    /// The number of buckets in a new table.
+    static const int initial_bucket_count = 16;
+
+    /// Hashes an address array. Every address is mixed in with the MurmurHash3
+    /// finalizer, starting from this table's seed.
+    uint32_t hash(const IgmpSourceList::address_list &addresses) const
+    {
+        uint32_t result = seed ^ (uint32_t)addresses.size();
+        for (const auto &address : addresses)
+        {
+            result ^= address.addr();
+            result ^= result >> 16;
+            result *= 0x85ebca6b;
+            result ^= result >> 13;
+            result *= 0xc2b2ae35;
+            result ^= result >> 16;
+        }
+        return result;
+    }
+
+    /// Puts a list at the front of its bucket.
+    void link(IgmpSourceList *list)
+    {
+        auto &bucket = buckets[list->hash & (buckets.size() - 1)];
+        list->next = bucket;
+        bucket = list;
+    }
+
+    /// Redistributes the lists over the given number of buckets, which must be a
+    /// power of two.
+    void rehash(int bucket_count)
+    {
+        Vector<IgmpSourceList *> old_buckets;
+        old_buckets.swap(buckets);
+        buckets.resize(bucket_count, nullptr);
+        for (auto list : old_buckets)
+        {
+            while (list != nullptr)
+            {
+                auto next = list->next;
+                link(list);
+                list = next;
+            }
+        }
+    }
+
+    /// Empties the hash table and interns the empty list. The table holds on to
+    /// the empty list, so it is never recycled.
+    void reset()
+    {
+        buckets.clear();
+        buckets.resize(initial_bucket_count, nullptr);
+        count = 0;
+        referenced_addresses = 0;
+        empty_list = const_cast<IgmpSourceList *>(intern(IgmpSourceList::address_list()));
+    }
+
+    /// The seed for the hash function.
+    uint32_t seed;
+
+    /// The pool that lists are allocated from.
+    SlabPool<IgmpSourceList> pool;
+
+    /// The hash buckets, each of which is a chain of lists. The number of buckets
+    /// is a power of two.
+    Vector<IgmpSourceList *> buckets;
+
+    /// The number of lists in the table.
+    int count;
+
+    /// The sum of the sizes of all references to lists.
+    int referenced_addresses;
+
+    /// The empty list.
+    IgmpSourceList *empty_list;
+};
+
+CLICK_ENDDECLS
@@ -0,0 +1,131 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+
+// The vectorized kernels are only built for user-level x86 code: kernel code must
+// not touch the vector registers, and other architectures use the scalar kernel.
+#if !defined(CLICK_LINUXMODULE) && !defined(CLICK_BSDMODULE) && defined(__GNUC__) && \
+    (defined(__x86_64__) || defined(__i386__))
+#define IGMP_SOURCE_SEARCH_X86 1
+#include <immintrin.h>
+#endif
+
+CLICK_DECLS
+
+/// Source lists are searched in two steps: a binary search narrows the list down
+/// to at most this many addresses, which are then compared against the address
+/// that is looked up all at once. That replaces the last, unpredictable, branches
+/// of the binary search by a few vector compares.
+const int igmp_source_scan_window = 32;
+
+/// A function that finds the index of a 32-bit word in an array, or returns -1
+/// if the word does not occur in the array.
+typedef int (*IgmpFindWordFunction)(const uint32_t *words, int count, uint32_t word);
+
+/// Finds a word in an array, one word at a time.
+inline int igmp_find_word_scalar(const uint32_t *words, int count, uint32_t word)
+{
+    for (int i = 0; i < count; i++)
+    {
+        if (words[i] == word)
+        {
+            return i;
+        }
+    }
+    return -1;
+}
+
+#ifdef IGMP_SOURCE_SEARCH_X86
+
+/// Finds a word in an array, comparing four words per SSE2 instruction.
+__attribute__((target("sse2"))) inline int igmp_find_word_sse2(const uint32_t *words, int count, uint32_t word)
+{
+    __m128i needle = _mm_set1_epi32((int)word);
+    int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i *>(words + i));
+        int mask = _mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(block, needle)));
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    int rest = igmp_find_word_scalar(words + i, count - i, word);
+    return rest < 0 ? -1 : i + rest;
+}
+
+/// Finds a word in an array, comparing eight words per AVX2 instruction.
+__attribute__((target("avx2"))) inline int igmp_find_word_avx2(const uint32_t *words, int count, uint32_t word)
+{
+    __m256i needle = _mm256_set1_epi32((int)word);
+    int i = 0;
+    for (; i + 8 <= count; i += 8)
+    {
+        __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i *>(words + i));
+        int mask = _mm256_movemask_ps(_mm256_castsi256_ps(_mm256_cmpeq_epi32(block, needle)));
+        if (mask != 0)
+        {
+            return i + __builtin_ctz(mask);
+        }
+    }
+    int rest = igmp_find_word_sse2(words + i, count - i, word);
+    return rest < 0 ? -1 : i + rest;
+}
+
+#endif
+
+/// Picks the fastest kernel that the CPU supports.
+inline IgmpFindWordFunction igmp_select_find_word(const char **name = nullptr)
+{
+#ifdef IGMP_SOURCE_SEARCH_X86
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+    {
+        if (name != nullptr)
+        {
+            *name = "avx2";
+        }
+        return &igmp_find_word_avx2;
+    }
+    if (__builtin_cpu_supports("sse2"))
+    {
+        if (name != nullptr)
+        {
+            *name = "sse2";
+        }
+        return &igmp_find_word_sse2;
+    }
+#endif
+    if (name != nullptr)
+    {
+        *name = "scalar";
+    }
+    return &igmp_find_word_scalar;
+}
+
+/// The kernel that 'igmp_find_word' uses. It is picked when the program starts, so
+/// calls do not have to check if it has been picked yet.
+static const IgmpFindWordFunction igmp_find_word_kernel = igmp_select_find_word();
+
+/// Finds the index of a word in an array, or returns -1 if the word does not occur
+/// in the array.
+inline int igmp_find_word(const uint32_t *words, int count, uint32_t word)
+{
+    if (count == 0)
+    {
+        return -1;
+    }
+    return igmp_find_word_kernel(words, count, word);
+}
+
+/// Gets the name of the kernel that 'igmp_find_word' uses.
+inline const char *igmp_find_word_kernel_name()
+{
+    const char *name;
+    igmp_select_find_word(&name);
+    return name;
+}
+
+CLICK_ENDDECLS
@@ -0,0 +1,486 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/vector.hh>
+#include <clicknet/ip.h>
+#include "IgmpSourceSearch.hh"
+#include "SmallVector.hh"
+
+CLICK_DECLS
+
+/// Gets the key by which source addresses are ordered. Addresses are sorted
+/// numerically, i.e., in host byte order.
+inline uint32_t igmp_source_key(const IPAddress &address)
+{
+    return ntohl(address.addr());
+}
+
+/// Tests if the left source address precedes the right source address.
+inline bool igmp_source_less(const IPAddress &left, const IPAddress &right)
+{
+    return igmp_source_key(left) < igmp_source_key(right);
+}
+
+/// Gets an array of addresses as words in network byte order.
+inline const uint32_t *igmp_source_words(const IPAddress *addresses)
+{
+    static_assert(sizeof(IPAddress) == sizeof(uint32_t), "IP addresses must be plain words");
+    return reinterpret_cast<const uint32_t *>(addresses);
+}
+
+/// Finds the position of the first address in a sorted array of source addresses
+/// that does not precede the given address.
+inline int igmp_lower_bound_source(const IPAddress *addresses, int count, const IPAddress &address)
+{
+    int first = 0;
+    uint32_t key = igmp_source_key(address);
+    while (count > 0)
+    {
+        int step = count / 2;
+        if (igmp_source_key(addresses[first + step]) < key)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step;
+        }
+    }
+    return first;
+}
+
+/// Finds the position of an address in a sorted array of source addresses, or returns
+/// -1 if the address is not in the array. A binary search narrows the array down to a
+/// window of addresses, which is then scanned with the vectorized search kernel.
+inline int igmp_find_source(const IPAddress *addresses, int count, const IPAddress &address)
+{
+    int first = 0;
+    uint32_t key = igmp_source_key(address);
+    while (count > igmp_source_scan_window)
+    {
+        int step = count / 2;
+        if (igmp_source_key(addresses[first + step]) < key)
+        {
+            first += step + 1;
+            count -= step + 1;
+        }
+        else
+        {
+            count = step + 1;
+        }
+    }
+    int index = igmp_find_word(igmp_source_words(addresses + first), count, address.addr());
+    return index < 0 ? -1 : first + index;
+}
+
+/// Counts the addresses that two sorted arrays of source addresses have in common, in a
+/// single merge pass.
+inline int igmp_count_common_sources(
+    const IPAddress *left, int left_count, const IPAddress *right, int right_count)
+{
+    int common = 0;
+    int left_index = 0;
+    int right_index = 0;
+    while (left_index < left_count && right_index < right_count)
+    {
+        uint32_t left_key = igmp_source_key(left[left_index]);
+        uint32_t right_key = igmp_source_key(right[right_index]);
+        if (left_key < right_key)
+        {
+            left_index++;
+        }
+        else if (right_key < left_key)
+        {
+            right_index++;
+        }
+        else
+        {
+            common++;
+            left_index++;
+            right_index++;
+        }
+    }
+    return common;
+}
+
+/// A set of IPv4 source addresses. The addresses are kept sorted and free of
+/// duplicates, so membership tests are binary searches and unions, intersections
+/// and differences are single merge passes over both operands.
+///
+/// Most sets are empty (plain joins and leaves) or hold a few sources (source-specific
+/// joins), so up to 'inline_capacity' addresses are stored in the set itself. Only
+/// larger sets allocate.
+class IgmpSourceSet
+{
+  public:
+    /// The number of addresses that a set stores without allocating.
+    static const int inline_capacity = 4;
+
+    typedef const IPAddress *const_iterator;
+    typedef const_iterator iterator;
+
+    /// Creates an empty source set.
+    IgmpSourceSet()
+        : addresses()
+    {
+    }
+
+    /// Creates a source set from a list of addresses. The list need not be sorted
+    /// and may contain duplicates.
+    IgmpSourceSet(const Vector<IPAddress> &addresses)
+        : addresses()
+    {
+        assign(addresses.begin(), addresses.end());
+    }
+
+    IgmpSourceSet(const IgmpSourceSet &) = default;
+    IgmpSourceSet &operator=(const IgmpSourceSet &) = default;
+
+    /// Moves a source set's addresses into a new set. The other set is left empty.
+    IgmpSourceSet(IgmpSourceSet &&other)
+        : addresses()
+    {
+        addresses.swap(other.addresses);
+    }
+
+    /// Moves a source set's addresses into this set. The other set is left empty.
+    IgmpSourceSet &operator=(IgmpSourceSet &&other)
+    {
+        if (this != &other)
+        {
+            addresses.swap(other.addresses);
+            other.addresses.clear();
+        }
+        return *this;
+    }
+
+    /// Swaps the contents of this set with those of another set. This does not
+    /// allocate.
+    void swap(IgmpSourceSet &other)
+    {
+        addresses.swap(other.addresses);
+    }
+
+    /// Replaces this set's contents by the addresses in the given range. The range
+    /// need not be sorted and may contain duplicates. The set's storage is reused,
+    /// so assigning to a set that has held as many addresses before does not
+    /// allocate.
+    template <typename TIterator>
+    void assign(TIterator first, TIterator last)
+    {
+        addresses.clear();
+        for (TIterator it = first; it != last; ++it)
+        {
+            addresses.push_back(*it);
+        }
+        normalize();
+    }
+
+    /// Adds an address to the end of this set without restoring the set's order.
+    /// 'normalize' must be called once all addresses have been added.
+    void append_unsorted(const IPAddress &address)
+    {
+        addresses.push_back(address);
+    }
+
+    /// Restores this set's order after a sequence of 'append_unsorted' calls.
+    /// Lists that are already sorted, as source lists usually are, are only
+    /// scanned once.
+    void normalize()
+    {
+        for (int i = 1; i < addresses.size(); i++)
+        {
+            if (!igmp_source_less(addresses[i - 1], addresses[i]))
+            {
+                sort_and_deduplicate();
+                return;
+            }
+        }
+    }
+
+    /// Appends an address to this set. The address must be greater than every
+    /// address that is already in the set; this is what lets merge passes build
+    /// their results in linear time.
+    void append_sorted(const IPAddress &address)
+    {
+        assert(addresses.empty() || igmp_source_less(addresses.back(), address));
+        addresses.push_back(address);
+    }
+
+    /// Reserves room for the given number of addresses.
+    void reserve(int count)
+    {
+        addresses.reserve(count);
+    }
+
+    /// Gets the number of addresses in this set.
+    int size() const { return addresses.size(); }
+
+    /// Tests if this set is empty.
+    bool empty() const { return addresses.empty(); }
+
+    /// Gets the address at the given position in this set.
+    const IPAddress &operator[](int index) const { return addresses[index]; }
+
+    const_iterator begin() const { return addresses.begin(); }
+    const_iterator end() const { return addresses.end(); }
+
+    /// Finds the position of the first address in this set that does not precede
+    /// the given address.
+    const_iterator lower_bound(const IPAddress &address) const
+    {
+        return begin() + igmp_lower_bound_source(begin(), size(), address);
+    }
+
+    /// Tests if this set contains the given address.
+    bool contains(const IPAddress &address) const
+    {
+        return igmp_find_source(begin(), size(), address) >= 0;
+    }
+
+    /// Inserts an address into this set. A Boolean result tells if the address
+    /// was not in the set yet.
+    bool insert(const IPAddress &address)
+    {
+        auto it = lower_bound(address);
+        if (it != end() && *it == address)
+        {
+            return false;
+        }
+        addresses.insert(addresses.begin() + (it - begin()), address);
+        return true;
+    }
+
+    /// Erases an address from this set. A Boolean result tells if the address
+    /// was in the set.
+    bool erase(const IPAddress &address)
+    {
+        auto it = lower_bound(address);
+        if (it == end() || *it != address)
+        {
+            return false;
+        }
+        addresses.erase(addresses.begin() + (it - begin()));
+        return true;
+    }
+
+    /// Removes all addresses from this set.
+    void clear()
+    {
+        addresses.clear();
+    }
+
+    /// Removes every address from this set that is not in the given set. This
+    /// compacts the set in place and does not allocate.
+    void intersect(const IgmpSourceSet &other)
+    {
+        retain(other, true);
+    }
+
+    /// Removes every address from this set that is in the given set. This
+    /// compacts the set in place and does not allocate.
+    void subtract(const IgmpSourceSet &other)
+    {
+        retain(other, false);
+    }
+
+    /// Replaces this set's contents by the addresses in 'left' that are not in
+    /// 'right', in a single merge pass. The set's storage is reused. Neither operand
+    /// may be this set.
+    void assign_difference(const IgmpSourceSet &left, const IgmpSourceSet &right)
+    {
+        assert(&left != this && &right != this);
+        addresses.clear();
+        addresses.reserve(left.size());
+        if (right.size() <= igmp_source_scan_window)
+        {
+            // Small sets are faster to scan than to merge.
+            for (const auto &address : left)
+            {
+                if (!right.scan(address))
+                {
+                    addresses.push_back(address);
+                }
+            }
+            return;
+        }
+
+        auto right_it = right.begin();
+        for (const auto &address : left)
+        {
+            uint32_t key = igmp_source_key(address);
+            while (right_it != right.end() && igmp_source_key(*right_it) < key)
+            {
+                ++right_it;
+            }
+            if (right_it == right.end() || *right_it != address)
+            {
+                addresses.push_back(address);
+            }
+        }
+    }
+
+    /// Tests if every address in this set is also in the given set.
+    bool is_subset_of(const IgmpSourceSet &other) const
+    {
+        auto other_it = other.begin();
+        for (const auto &address : *this)
+        {
+            uint32_t key = igmp_source_key(address);
+            while (other_it != other.end() && igmp_source_key(*other_it) < key)
+            {
+                ++other_it;
+            }
+            if (other_it == other.end() || *other_it != address)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator==(const IgmpSourceSet &other) const
+    {
+        if (size() != other.size())
+        {
+            return false;
+        }
+        for (int i = 0; i < size(); i++)
+        {
+            if (addresses[i] != other.addresses[i])
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool operator!=(const IgmpSourceSet &other) const
+    {
+        return !(*this == other);
+    }
+
+  private:
+    /// Keeps only the addresses whose membership of the given set equals
+    /// 'keep_members'.
+    void retain(const IgmpSourceSet &other, bool keep_members)
+    {
+        int count = 0;
+        if (other.size() <= igmp_source_scan_window)
+        {
+            // Small sets are faster to scan than to merge.
+            for (int i = 0; i < size(); i++)
+            {
+                if (other.scan(addresses[i]) == keep_members)
+                {
+                    addresses[count++] = addresses[i];
+                }
+            }
+            addresses.resize(count);
+            return;
+        }
+
+        auto other_it = other.begin();
+        for (int i = 0; i < size(); i++)
+        {
+            uint32_t key = igmp_source_key(addresses[i]);
+            while (other_it != other.end() && igmp_source_key(*other_it) < key)
+            {
+                ++other_it;
+            }
+            bool is_member = other_it != other.end() && *other_it == addresses[i];
+            if (is_member == keep_members)
+            {
+                addresses[count++] = addresses[i];
+            }
+        }
+        addresses.resize(count);
+    }
+
+    /// Tests if this set contains the given address by scanning all of its addresses
+    /// with the vectorized search kernel. Only meant for small sets.
+    bool scan(const IPAddress &address) const
+    {
+        return igmp_find_word(igmp_source_words(begin()), size(), address.addr()) >= 0;
+    }
+
+    static int compare_sources(const void *left, const void *right, void *)
+    {
+        uint32_t left_key = igmp_source_key(*reinterpret_cast<const IPAddress *>(left));
+        uint32_t right_key = igmp_source_key(*reinterpret_cast<const IPAddress *>(right));
+        return left_key < right_key ? -1 : (left_key > right_key ? 1 : 0);
+    }
+
+    void sort_and_deduplicate()
+    {
+        click_qsort(addresses.begin(), addresses.size(), sizeof(IPAddress), &compare_sources, nullptr);
+        int count = 0;
+        for (int i = 0; i < addresses.size(); i++)
+        {
+            if (count == 0 || addresses[count - 1] != addresses[i])
+            {
+                addresses[count++] = addresses[i];
+            }
+        }
+        addresses.resize(count);
+    }
+
+    /// The set's addresses, in ascending order.
+    SmallVector<IPAddress, inline_capacity> addresses;
+};
+
+/// Creates a source set whose elements are the union of the given sets.
+inline IgmpSourceSet union_source_sets(const IgmpSourceSet &left, const IgmpSourceSet &right)
+{
+    IgmpSourceSet results;
+    results.reserve(left.size() + right.size());
+    auto left_it = left.begin();
+    auto right_it = right.begin();
+    while (left_it != left.end() && right_it != right.end())
+    {
+        uint32_t left_key = igmp_source_key(*left_it);
+        uint32_t right_key = igmp_source_key(*right_it);
+        if (left_key < right_key)
+        {
+            results.append_sorted(*left_it++);
+        }
+        else if (right_key < left_key)
+        {
+            results.append_sorted(*right_it++);
+        }
+        else
+        {
+            results.append_sorted(*left_it++);
+            ++right_it;
+        }
+    }
+    for (; left_it != left.end(); ++left_it)
+    {
+        results.append_sorted(*left_it);
+    }
+    for (; right_it != right.end(); ++right_it)
+    {
+        results.append_sorted(*right_it);
+    }
+    return results;
+}
+
+/// Creates a source set whose elements are the intersection of the given sets.
+inline IgmpSourceSet intersect_source_sets(const IgmpSourceSet &left, const IgmpSourceSet &right)
+{
+    IgmpSourceSet results = left;
+    results.intersect(right);
+    return results;
+}
+
+/// Creates a source set whose elements are the difference of the given sets.
+inline IgmpSourceSet difference_source_sets(const IgmpSourceSet &left, const IgmpSourceSet &right)
+{
+    IgmpSourceSet results;
+    results.assign_difference(left, right);
+    return results;
+}
+
+CLICK_ENDDECLS
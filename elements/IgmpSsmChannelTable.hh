@@ -0,0 +1,244 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/glue.hh>
+#include <click/string.hh>
+#include <click/timestamp.hh>
+#include <click/vector.hh>
+#include <clicknet/ip.h>
+
+CLICK_DECLS
+
+/// An exact-match table of source-specific multicast channels, i.e., (source, group)
+/// pairs, and the times at which they expire.
+///
+/// Channels are keyed by a single 64-bit word that holds the group address in its
+/// high half and the source address in its low half. Keys are stored in an
+/// open-addressed array with linear probing and a per-table random seed; expiry times
+/// live in a parallel array, so probing only touches keys. Group addresses are never
+/// zero, which frees up the keys with a zero high half to mark empty and deleted slots.
+class IgmpSsmChannelTable final
+{
+  public:
+    IgmpSsmChannelTable()
+        : seed(((uint64_t)click_random() << 32) ^ ((uint64_t)click_random() << 16) ^ (uint64_t)click_random()),
+          count(0), tombstones(0)
+    {
+    }
+
+    IgmpSsmChannelTable(const IgmpSsmChannelTable &) = delete;
+    IgmpSsmChannelTable &operator=(const IgmpSsmChannelTable &) = delete;
+
+    /// Gets the number of channels in this table.
+    int size() const { return count; }
+
+    /// Gets a pointer to the expiry time of the given channel, or null if the channel
+    /// is not in this table.
+    const Timestamp *findp(const IPAddress &multicast_address, const IPAddress &source_address) const
+    {
+        int index = find_slot(make_key(multicast_address, source_address));
+        return index < 0 ? nullptr : &expiries[index];
+    }
+
+    /// Sets the time at which the given channel expires. The channel is added to
+    /// this table if it is not in the table yet.
+    void insert(const IPAddress &multicast_address, const IPAddress &source_address, const Timestamp &expiry)
+    {
+        if ((count + tombstones + 1) * 2 > keys.size())
+        {
+            rehash();
+        }
+
+        // Look for the key and for a free slot in a single probe sequence. A new key
+        // takes the first deleted slot along the way, if there is one.
+        uint64_t key = make_key(multicast_address, source_address);
+        uint64_t mask = keys.size() - 1;
+        int free_index = -1;
+        for (uint64_t index = hash(key) & mask;; index = (index + 1) & mask)
+        {
+            if (keys[index] == key)
+            {
+                expiries[index] = expiry;
+                return;
+            }
+            else if (keys[index] == slot_deleted && free_index < 0)
+            {
+                free_index = index;
+            }
+            else if (keys[index] == slot_empty)
+            {
+                if (free_index < 0)
+                {
+                    free_index = index;
+                }
+                else
+                {
+                    tombstones--;
+                }
+                break;
+            }
+        }
+
+        keys[free_index] = key;
+        expiries[free_index] = expiry;
+        count++;
+    }
+
+    /// Removes all channels that have expired at the given time. If channels remain,
+    /// then 'next_expiry' is set to the earliest time at which one of them expires and
+    /// 'has_next_expiry' is set to true; otherwise, both are left untouched. A Boolean
+    /// result tells if any channels were removed.
+    bool erase_expired(const Timestamp &now, Timestamp &next_expiry, bool &has_next_expiry)
+    {
+        bool any_erased = false;
+        for (int i = 0; i < keys.size(); i++)
+        {
+            if (!is_full(keys[i]))
+            {
+                continue;
+            }
+
+            if (!(now < expiries[i]))
+            {
+                keys[i] = slot_deleted;
+                count--;
+                tombstones++;
+                any_erased = true;
+            }
+            else if (!has_next_expiry || expiries[i] < next_expiry)
+            {
+                next_expiry = expiries[i];
+                has_next_expiry = true;
+            }
+        }
+
+        // Deleted slots lengthen probe sequences, so clean them up once they make
+        // up a quarter of the table.
+        if (tombstones * 4 > keys.size())
+        {
+            rehash();
+        }
+        return any_erased;
+    }
+
+    /// Removes all channels from this table.
+    void clear()
+    {
+        keys.clear();
+        expiries.clear();
+        count = 0;
+        tombstones = 0;
+    }
+
+    /// Describes this table's usage.
+    String to_string() const
+    {
+        return String(count) + " channels, " + String(keys.size()) + " slots";
+    }
+
+  private:
+    static const uint64_t slot_empty = 0;
+    static const uint64_t slot_deleted = 1;
+
+    /// The smallest number of slots in a table.
+    static const int min_capacity = 16;
+
+    static uint64_t make_key(const IPAddress &multicast_address, const IPAddress &source_address)
+    {
+        return ((uint64_t)multicast_address.addr() << 32) | source_address.addr();
+    }
+
+    static bool is_full(uint64_t key)
+    {
+        return (key >> 32) != 0;
+    }
+
+    /// Hashes a key. This is the 64-bit finalizer from MurmurHash3, applied to the
+    /// key mixed with this table's seed.
+    uint64_t hash(uint64_t key) const
+    {
+        uint64_t result = key ^ seed;
+        result ^= result >> 33;
+        result *= 0xff51afd7ed558ccdULL;
+        result ^= result >> 33;
+        result *= 0xc4ceb9fe1a85ec53ULL;
+        result ^= result >> 33;
+        return result;
+    }
+
+    /// Finds the slot that holds the given key, or returns -1.
+    int find_slot(uint64_t key) const
+    {
+        if (count == 0)
+        {
+            return -1;
+        }
+
+        uint64_t mask = keys.size() - 1;
+        for (uint64_t index = hash(key) & mask;; index = (index + 1) & mask)
+        {
+            if (keys[index] == key)
+            {
+                return index;
+            }
+            else if (keys[index] == slot_empty)
+            {
+                return -1;
+            }
+        }
+    }
+
+    /// Moves all channels to a table that is at most a quarter full, dropping deleted
+    /// slots along the way.
+    void rehash()
+    {
+        int capacity = min_capacity;
+        while (count * 4 > capacity)
+        {
+            capacity *= 2;
+        }
+
+        Vector<uint64_t> old_keys;
+        Vector<Timestamp> old_expiries;
+        old_keys.swap(keys);
+        old_expiries.swap(expiries);
+        keys.resize(capacity, uint64_t(slot_empty));
+        expiries.resize(capacity, Timestamp());
+        tombstones = 0;
+
+        // The new table has no deleted slots and every key is distinct, so every key
+        // simply goes in the first empty slot of its probe sequence.
+        uint64_t mask = capacity - 1;
+        for (int i = 0; i < old_keys.size(); i++)
+        {
+            if (!is_full(old_keys[i]))
+            {
+                continue;
+            }
+
+            uint64_t index = hash(old_keys[i]) & mask;
+            while (keys[index] != slot_empty)
+            {
+                index = (index + 1) & mask;
+            }
+            keys[index] = old_keys[i];
+            expiries[index] = old_expiries[i];
+        }
+    }
+
+    /// The seed for the hash function.
+    uint64_t seed;
+
+    /// The channel keys, or 'slot_empty' or 'slot_deleted'. The number of slots is
+    /// zero or a power of two.
+    Vector<uint64_t> keys;
+    /// The expiry times of the channels, in the same order as 'keys'.
+    Vector<Timestamp> expiries;
+
+    /// The number of channels.
+    int count;
+    /// The number of deleted slots.
+    int tombstones;
+};
+
+CLICK_ENDDECLS
@@ -1,35 +1,136 @@
 #pragma once
 
 #include <click/config.h>
+#include <click/vector.hh>
+#include <new>
 
 CLICK_DECLS
 
+template <typename T>
+class RcPool;
+
+/// The heap block behind an 'Rc': a value, its reference count and the pool that the
+/// block was drawn from, if any. Keeping all three together means that creating an
+/// 'Rc' takes a single allocation.
+template <typename T>
+struct RcBox final
+{
+    template <typename... TArgs>
+    RcBox(RcPool<T> *pool, const TArgs &... values)
+        : ref_count(1), pool(pool), value(values...)
+    {
+    }
+
+    RcBox(const RcBox &) = delete;
+    RcBox &operator=(const RcBox &) = delete;
+
+    /// The number of handles that refer to this block.
+    size_t ref_count;
+    /// The pool that this block is returned to, or null if it was allocated with 'new'.
+    RcPool<T> *pool;
+    /// The value that is managed.
+    T value;
+};
+
+/// A pool of blocks for reference-counted values. Blocks are returned to the pool
+/// once their value's reference count drops to zero and are reused by the next value
+/// that is allocated from the pool. A pool must outlive every value that is
+/// allocated from it.
+template <typename T>
+class RcPool final
+{
+  public:
+    RcPool()
+    {
+    }
+
+    RcPool(const RcPool &) = delete;
+    RcPool &operator=(const RcPool &) = delete;
+
+    ~RcPool()
+    {
+        for (auto block : free_blocks)
+        {
+            ::operator delete(block);
+        }
+    }
+
+    /// Takes an uninitialized block from this pool.
+    void *allocate()
+    {
+        if (free_blocks.empty())
+        {
+            return ::operator new(sizeof(RcBox<T>));
+        }
+
+        void *result = free_blocks.back();
+        free_blocks.pop_back();
+        return result;
+    }
+
+    /// Returns a block to this pool. The block's value must have been destroyed.
+    void deallocate(void *block)
+    {
+        free_blocks.push_back(block);
+    }
+
+    /// Gets the number of blocks that are waiting to be reused.
+    int free_count() const
+    {
+        return free_blocks.size();
+    }
+
+  private:
+    Vector<void *> free_blocks;
+};
+
 /// A reference-counted non-null pointer to a shared value that resides in the heap.
+/// The value and its reference count share a single allocation, which is drawn from
+/// a pool if the value was created with 'allocate_in'.
+///
+/// A handle that has been moved from is null; it may only be assigned to or destroyed.
 template <typename T>
 class Rc final
 {
   public:
     template <typename... TArgs>
     Rc(const TArgs &... values)
-        : val(new T(values...)), ref_count(new size_t(1))
+        : box(new RcBox<T>(nullptr, values...))
     {
     }
 
     Rc(const Rc<T> &other)
-        : val(other.val), ref_count(other.ref_count)
+        : box(other.box)
     {
         inc_ref_count();
     }
 
+    Rc(Rc<T> &&other)
+        : box(other.box)
+    {
+        other.box = nullptr;
+    }
+
     Rc<T> &operator=(const Rc<T> &other)
     {
-        if (this != &other)
+        if (box != other.box)
         {
             dec_ref_count();
-            val = other.val;
-            ref_count = other.ref_count;
+            box = other.box;
             inc_ref_count();
         }
+        return *this;
+    }
+
+    Rc<T> &operator=(Rc<T> &&other)
+    {
+        if (this != &other)
+        {
+            dec_ref_count();
+            box = other.box;
+            other.box = nullptr;
+        }
+        return *this;
     }
 
     ~Rc()
@@ -37,30 +138,55 @@ class Rc final
         dec_ref_count();
     }
 
-    T *get() const { return val; }
-    T &operator*() const { return *val; }
-    T *operator->() const { return val; }
+    /// Creates a reference-counted value in a block from the given pool.
+    template <typename... TArgs>
+    static Rc<T> allocate_in(RcPool<T> &pool, const TArgs &... values)
+    {
+        return Rc<T>(new (pool.allocate()) RcBox<T>(&pool, values...));
+    }
+
+    T *get() const { return &box->value; }
+    T &operator*() const { return box->value; }
+    T *operator->() const { return &box->value; }
+
+    /// Gets the number of handles that share this handle's value.
+    size_t use_count() const { return box->ref_count; }
 
   private:
+    explicit Rc(RcBox<T> *box)
+        : box(box)
+    {
+    }
+
     void inc_ref_count()
     {
-        (*ref_count)++;
+        if (box != nullptr)
+        {
+            box->ref_count++;
+        }
     }
 
     void dec_ref_count()
     {
-        (*ref_count)--;
-        if (*ref_count == 0)
+        if (box == nullptr || --box->ref_count != 0)
+        {
+            return;
+        }
+
+        RcPool<T> *pool = box->pool;
+        if (pool == nullptr)
+        {
+            delete box;
+        }
+        else
         {
-            delete val;
-            delete ref_count;
+            box->~RcBox<T>();
+            pool->deallocate(box);
         }
     }
 
-    /// The value that is managed.
-    T *val;
-    /// The value's reference count.
-    size_t *ref_count;
+    /// The block that holds the value and its reference count.
+    RcBox<T> *box;
 };
 
 template <typename T, typename... TArgs>
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/string.hh>
+#include <click/vector.hh>
+#include <new>
+
+CLICK_DECLS
+
+/// A pool of objects that are carved from fixed-size slabs.
+///
+/// Objects that are released to the pool are not destroyed. They are put on a free
+/// list and handed out again, as they are, by the next call to 'acquire'. That way,
+/// an object keeps whatever it owns (buffers, timers) across uses, and churn does
+/// not turn into calls to 'malloc'. The owner of the pool is responsible for
+/// resetting recycled objects.
+///
+/// Objects never move, so pointers to them are stable until they are released.
+/// 'clear' destroys all objects and frees all slabs at once.
+template <typename T, int SlabSize = 64>
+class SlabPool final
+{
+  public:
+    /// The number of objects in a slab.
+    static const int slab_size = SlabSize;
+
+    SlabPool()
+        : object_count(0)
+    {
+    }
+
+    SlabPool(const SlabPool &) = delete;
+    SlabPool &operator=(const SlabPool &) = delete;
+
+    ~SlabPool()
+    {
+        clear();
+    }
+
+    /// Takes an object from this pool. A released object is recycled if there is
+    /// one. Otherwise, a new object is constructed from the given arguments.
+    template <typename... TArgs>
+    T *acquire(const TArgs &... args)
+    {
+        if (!free_objects.empty())
+        {
+            T *result = free_objects.back();
+            free_objects.pop_back();
+            return result;
+        }
+
+        if (object_count == capacity())
+        {
+            slabs.push_back(new unsigned char[sizeof(T) * slab_size]);
+        }
+
+        T *result = new (get_slot(object_count)) T(args...);
+        object_count++;
+        return result;
+    }
+
+    /// Returns an object to this pool. The object must have been acquired from
+    /// this pool and must not be used until it is acquired again.
+    void release(T *object)
+    {
+        free_objects.push_back(object);
+    }
+
+    /// Destroys all objects in this pool, whether they are in use or not, and
+    /// frees its slabs.
+    void clear()
+    {
+        for (int i = 0; i < object_count; i++)
+        {
+            get_slot(i)->~T();
+        }
+        for (auto slab : slabs)
+        {
+            delete[] slab;
+        }
+        slabs.clear();
+        free_objects.clear();
+        object_count = 0;
+    }
+
+    /// Gets the number of objects that are in use.
+    int size() const
+    {
+        return object_count - free_objects.size();
+    }
+
+    /// Gets the number of released objects that are waiting to be recycled.
+    int free_count() const
+    {
+        return free_objects.size();
+    }
+
+    /// Gets the number of objects that fit in this pool's slabs.
+    int capacity() const
+    {
+        return slabs.size() * slab_size;
+    }
+
+    /// Gets the number of slabs in this pool.
+    int slab_count() const
+    {
+        return slabs.size();
+    }
+
+    /// Gets the number of bytes in this pool's slabs. This does not include memory
+    /// that is owned by the objects themselves.
+    size_t get_memory_usage() const
+    {
+        return (size_t)capacity() * sizeof(T);
+    }
+
+    /// Describes this pool's usage.
+    String to_string() const
+    {
+        return String(size()) + " in use, " +
+               String(free_count()) + " free, " +
+               String(slab_count()) + " slabs (" +
+               String((unsigned long)get_memory_usage()) + " bytes)";
+    }
+
+  private:
+    T *get_slot(int index) const
+    {
+        return reinterpret_cast<T *>(slabs[index / slab_size]) + index % slab_size;
+    }
+
+    /// The slabs. Objects are constructed in them in order.
+    Vector<unsigned char *> slabs;
+
+    /// The number of objects that have been constructed in the slabs.
+    int object_count;
+
+    /// Released objects that can be recycled.
+    Vector<T *> free_objects;
+};
+
+CLICK_ENDDECLS
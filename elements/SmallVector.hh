@@ -0,0 +1,327 @@
+#pragma once
+
+#include <click/config.h>
+#include <new>
+
+CLICK_DECLS
+
+/// A vector that stores up to 'InlineCapacity' elements inside the vector object
+/// itself and only spills to the heap when it grows past that. Its interface is a
+/// subset of Click's 'Vector'.
+///
+/// Clearing or shrinking a vector keeps its storage, so a vector that has spilled
+/// to the heap stays there until it is destroyed or swapped.
+template <typename T, int InlineCapacity>
+class SmallVector final
+{
+  public:
+    typedef T *iterator;
+    typedef const T *const_iterator;
+
+    /// The number of elements that fit in the vector object itself.
+    static const int inline_capacity = InlineCapacity;
+
+    SmallVector()
+        : items(get_inline_items()), count(0), item_capacity(InlineCapacity)
+    {
+    }
+
+    SmallVector(const SmallVector &other)
+        : items(get_inline_items()), count(0), item_capacity(InlineCapacity)
+    {
+        append(other);
+    }
+
+    /// Moves another vector's elements into a new vector. A vector that has spilled
+    /// to the heap hands over its storage; the other vector is left empty.
+    SmallVector(SmallVector &&other)
+        : items(get_inline_items()), count(0), item_capacity(InlineCapacity)
+    {
+        swap(other);
+    }
+
+    SmallVector &operator=(const SmallVector &other)
+    {
+        if (this != &other)
+        {
+            clear();
+            append(other);
+        }
+        return *this;
+    }
+
+    SmallVector &operator=(SmallVector &&other)
+    {
+        if (this != &other)
+        {
+            clear();
+            swap(other);
+        }
+        return *this;
+    }
+
+    ~SmallVector()
+    {
+        clear();
+        if (!is_inline())
+        {
+            ::operator delete(items);
+        }
+    }
+
+    /// Gets the number of elements in this vector.
+    int size() const { return count; }
+
+    /// Tests if this vector is empty.
+    bool empty() const { return count == 0; }
+
+    /// Gets the number of elements that fit in this vector's storage.
+    int capacity() const { return item_capacity; }
+
+    /// Tests if this vector's elements are stored in the vector object itself.
+    bool is_inline() const { return items == get_inline_items(); }
+
+    iterator begin() { return items; }
+    iterator end() { return items + count; }
+    const_iterator begin() const { return items; }
+    const_iterator end() const { return items + count; }
+
+    T &operator[](int index) { return items[index]; }
+    const T &operator[](int index) const { return items[index]; }
+
+    T &back() { return items[count - 1]; }
+    const T &back() const { return items[count - 1]; }
+
+    /// Makes sure that this vector has room for at least the given number of
+    /// elements.
+    void reserve(int new_capacity)
+    {
+        if (new_capacity > item_capacity)
+        {
+            reallocate(new_capacity);
+        }
+    }
+
+    void push_back(const T &value)
+    {
+        if (count == item_capacity)
+        {
+            // The value may be an element of this vector, so copy it before the
+            // storage moves.
+            T copy(value);
+            grow(count + 1);
+            new (items + count) T(copy);
+        }
+        else
+        {
+            new (items + count) T(value);
+        }
+        count++;
+    }
+
+    void pop_back()
+    {
+        items[--count].~T();
+    }
+
+    /// Inserts a value before the given position and returns the position of the
+    /// inserted value.
+    iterator insert(iterator position, const T &value)
+    {
+        int index = position - items;
+        if (index == count)
+        {
+            push_back(value);
+            return items + index;
+        }
+
+        T copy(value);
+        if (count == item_capacity)
+        {
+            grow(count + 1);
+        }
+        new (items + count) T(items[count - 1]);
+        for (int i = count - 1; i > index; i--)
+        {
+            items[i] = items[i - 1];
+        }
+        items[index] = copy;
+        count++;
+        return items + index;
+    }
+
+    /// Erases the element at the given position and returns the position of the
+    /// element that followed it.
+    iterator erase(iterator position)
+    {
+        return erase(position, position + 1);
+    }
+
+    /// Erases the elements in the given range and returns the position of the
+    /// element that followed them.
+    iterator erase(iterator first, iterator last)
+    {
+        int index = first - items;
+        int erased = last - first;
+        for (int i = index; i + erased < count; i++)
+        {
+            items[i] = items[i + erased];
+        }
+        truncate(count - erased);
+        return items + index;
+    }
+
+    /// Resizes this vector. New elements are copies of the given value.
+    void resize(int new_size, const T &value = T())
+    {
+        if (new_size <= count)
+        {
+            truncate(new_size);
+            return;
+        }
+
+        reserve(new_size);
+        while (count < new_size)
+        {
+            new (items + count) T(value);
+            count++;
+        }
+    }
+
+    /// Destroys all elements in this vector. Its storage is kept.
+    void clear()
+    {
+        truncate(0);
+    }
+
+    /// Swaps the contents of this vector with those of another vector. This only
+    /// copies elements that are stored inline.
+    void swap(SmallVector &other)
+    {
+        if (!is_inline() && !other.is_inline())
+        {
+            T *other_items = other.items;
+            other.items = items;
+            items = other_items;
+        }
+        else if (!is_inline())
+        {
+            other.swap_with_heap(*this);
+            return;
+        }
+        else if (!other.is_inline())
+        {
+            swap_with_heap(other);
+            return;
+        }
+        else
+        {
+            swap_inline(other);
+        }
+        int other_count = other.count;
+        other.count = count;
+        count = other_count;
+        int other_capacity = other.item_capacity;
+        other.item_capacity = item_capacity;
+        item_capacity = other_capacity;
+    }
+
+  private:
+    T *get_inline_items() const
+    {
+        return reinterpret_cast<T *>(const_cast<unsigned char *>(inline_storage));
+    }
+
+    /// Appends copies of another vector's elements.
+    void append(const SmallVector &other)
+    {
+        reserve(count + other.count);
+        for (const auto &item : other)
+        {
+            new (items + count) T(item);
+            count++;
+        }
+    }
+
+    /// Destroys the elements past the given size.
+    void truncate(int new_size)
+    {
+        while (count > new_size)
+        {
+            items[--count].~T();
+        }
+    }
+
+    /// Makes room for at least the given number of elements, growing geometrically.
+    void grow(int min_capacity)
+    {
+        int new_capacity = item_capacity * 2;
+        reallocate(new_capacity < min_capacity ? min_capacity : new_capacity);
+    }
+
+    /// Moves this vector's elements to heap storage with the given capacity.
+    void reallocate(int new_capacity)
+    {
+        T *new_items = static_cast<T *>(::operator new(sizeof(T) * new_capacity));
+        for (int i = 0; i < count; i++)
+        {
+            new (new_items + i) T(items[i]);
+            items[i].~T();
+        }
+        if (!is_inline())
+        {
+            ::operator delete(items);
+        }
+        items = new_items;
+        item_capacity = new_capacity;
+    }
+
+    /// Swaps contents with a vector that has spilled to the heap while this vector
+    /// has not. The other vector takes this vector's elements inline and this vector
+    /// takes the other vector's heap storage.
+    void swap_with_heap(SmallVector &other)
+    {
+        T *heap_items = other.items;
+        int heap_count = other.count;
+        int heap_capacity = other.item_capacity;
+
+        other.items = other.get_inline_items();
+        other.count = 0;
+        other.item_capacity = InlineCapacity;
+        other.append(*this);
+        clear();
+
+        items = heap_items;
+        count = heap_count;
+        item_capacity = heap_capacity;
+    }
+
+    /// Swaps contents with another vector when both store their elements inline.
+    void swap_inline(SmallVector &other)
+    {
+        SmallVector *shorter = count < other.count ? this : &other;
+        SmallVector *longer = count < other.count ? &other : this;
+        for (int i = 0; i < shorter->count; i++)
+        {
+            T item(items[i]);
+            items[i] = other.items[i];
+            other.items[i] = item;
+        }
+        for (int i = shorter->count; i < longer->count; i++)
+        {
+            new (shorter->items + i) T(longer->items[i]);
+            longer->items[i].~T();
+        }
+    }
+
+    /// The vector's elements. This points either to 'inline_storage' or to the heap.
+    T *items;
+    /// The number of elements in the vector.
+    int count;
+    /// The number of elements that fit in 'items'.
+    int item_capacity;
+    /// Storage for up to 'InlineCapacity' elements.
+    alignas(T) unsigned char inline_storage[sizeof(T) * InlineCapacity];
+};
+
+CLICK_ENDDECLS
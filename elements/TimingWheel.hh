@@ -0,0 +1,327 @@
+#pragma once
+
+#include <click/config.h>
+#include <click/vector.hh>
+
+CLICK_DECLS
+
+/// A hierarchical timing wheel: a set of events, each of which expires at some tick.
+/// Inserting and cancelling an event takes constant time, and so does popping an
+/// expired event (amortized over the cascades described below).
+///
+/// The wheel has 'level_count' levels of 'slot_count' slots each. A slot in level 0
+/// covers a single tick, a slot in level 1 covers 'slot_count' ticks, and so on. Every
+/// event lives in a doubly-linked list in the lowest-level slot that can represent its
+/// expiry relative to the wheel's current tick. Whenever the current tick reaches the
+/// start of a higher-level slot, that slot's events are cascaded into lower levels.
+/// Events that are too far in the future for even the highest level are kept in an
+/// overflow list until the highest level completes a full turn.
+///
+/// Event nodes are recycled through a free list, so a fired or cancelled event's
+/// storage is reclaimed immediately.
+template <typename TEvent>
+class TimingWheel final
+{
+  public:
+    /// Identifies a scheduled event. A handle consists of a node index and that node's
+    /// generation, which changes every time the node is recycled. Handles of events
+    /// that have fired or have been cancelled therefore never match a later event.
+    typedef uint64_t handle_type;
+
+    TimingWheel()
+        : nodes(), free_list(-1), current_tick(0), event_count(0)
+    {
+        reset_slots();
+    }
+
+    /// Tests if this wheel contains no events.
+    bool empty() const { return event_count == 0; }
+
+    /// Gets the number of events in this wheel.
+    int size() const { return event_count; }
+
+    /// Gets the number of event nodes this wheel has allocated, including recycled
+    /// nodes on the free list.
+    int capacity() const { return nodes.size(); }
+
+    /// Gets the wheel's current tick, i.e., the last tick it has processed.
+    uint64_t get_current_tick() const { return current_tick; }
+
+    /// Moves an empty wheel's current tick forward to the given tick. This should be
+    /// called before inserting events into a wheel that may have been idle, so the
+    /// events' expiries stay close to the current tick.
+    void synchronize(uint64_t now_tick)
+    {
+        if (empty() && now_tick > current_tick)
+        {
+            current_tick = now_tick;
+        }
+    }
+
+    /// Inserts an event that expires at the given tick. Events cannot expire at or
+    /// before the current tick: such events expire at the next tick instead.
+    handle_type insert(uint64_t expiry_tick, const TEvent &event)
+    {
+        if (expiry_tick <= current_tick)
+        {
+            expiry_tick = current_tick + 1;
+        }
+
+        int index = allocate_node();
+        Node &node = nodes[index];
+        node.event = event;
+        node.expiry_tick = expiry_tick;
+        link_node(index);
+        event_count++;
+        return ((handle_type)node.generation << 32) | (uint32_t)index;
+    }
+
+    /// Cancels the event with the given handle. A Boolean result tells if the event
+    /// was still pending.
+    bool cancel(handle_type handle)
+    {
+        int index = (int)(uint32_t)handle;
+        uint32_t generation = (uint32_t)(handle >> 32);
+        if (index < 0 || index >= nodes.size() || nodes[index].generation != generation || nodes[index].slot < 0)
+        {
+            return false;
+        }
+
+        unlink_node(index);
+        free_node(index);
+        return true;
+    }
+
+    /// Removes all events from this wheel.
+    void clear()
+    {
+        for (int i = 0; i < nodes.size(); i++)
+        {
+            if (nodes[i].slot >= 0)
+            {
+                free_node(i);
+            }
+        }
+        reset_slots();
+    }
+
+    /// Gets the tick at which the wheel next needs to be advanced, i.e., the expiry
+    /// of the earliest event or the tick at which a higher-level slot must be
+    /// cascaded. A Boolean result tells if the wheel contains any events at all.
+    bool next_tick(uint64_t &result) const
+    {
+        if (empty())
+        {
+            return false;
+        }
+
+        for (int level = 0; level < level_count; level++)
+        {
+            if (occupied[level] != 0)
+            {
+                // All occupied slots in a level lie ahead of the current tick's slot
+                // in that level, so the lowest occupied slot is the earliest one.
+                int slot_index = __builtin_ctzll(occupied[level]);
+                int level_shift = slot_bits * level;
+                int turn_shift = slot_bits * (level + 1);
+                result = ((current_tick >> turn_shift) << turn_shift) | ((uint64_t)slot_index << level_shift);
+                return true;
+            }
+        }
+
+        // Only overflow events are left. Wake up when the highest level completes
+        // its turn.
+        int turn_shift = slot_bits * level_count;
+        result = ((current_tick >> turn_shift) + 1) << turn_shift;
+        return true;
+    }
+
+    /// Pops an event that has expired at or before the given tick. The event's node
+    /// is recycled before this method returns. A Boolean result tells if an expired
+    /// event was found.
+    bool pop_expired(uint64_t now_tick, TEvent &result)
+    {
+        while (true)
+        {
+            int index = heads[current_tick & slot_mask];
+            if (index >= 0)
+            {
+                result = nodes[index].event;
+                unlink_node(index);
+                free_node(index);
+                return true;
+            }
+
+            uint64_t tick;
+            if (!next_tick(tick) || tick > now_tick)
+            {
+                synchronize(now_tick);
+                return false;
+            }
+
+            current_tick = tick;
+            cascade();
+        }
+    }
+
+  private:
+    static const int slot_bits = 6;
+    static const int slot_count = 1 << slot_bits;
+    static const uint64_t slot_mask = slot_count - 1;
+    static const int level_count = 4;
+    static const int overflow_slot = level_count * slot_count;
+
+    struct Node
+    {
+        TEvent event;
+        uint64_t expiry_tick;
+        uint32_t generation;
+        /// The slot that contains the node, or -1 if the node is on the free list.
+        int slot;
+        int prev;
+        int next;
+    };
+
+    void reset_slots()
+    {
+        for (int i = 0; i <= overflow_slot; i++)
+        {
+            heads[i] = -1;
+        }
+        for (int i = 0; i < level_count; i++)
+        {
+            occupied[i] = 0;
+        }
+    }
+
+    int allocate_node()
+    {
+        if (free_list >= 0)
+        {
+            int index = free_list;
+            free_list = nodes[index].next;
+            return index;
+        }
+
+        Node node;
+        node.expiry_tick = 0;
+        node.generation = 0;
+        node.slot = -1;
+        node.prev = -1;
+        node.next = -1;
+        nodes.push_back(node);
+        return nodes.size() - 1;
+    }
+
+    void free_node(int index)
+    {
+        Node &node = nodes[index];
+        node.event = TEvent();
+        node.generation++;
+        node.slot = -1;
+        node.prev = -1;
+        node.next = free_list;
+        free_list = index;
+        event_count--;
+    }
+
+    /// Gets the slot for an event that expires at the given tick, relative to the
+    /// current tick. The event goes in the lowest level in which its expiry and the
+    /// current tick fall in the same turn.
+    int get_slot(uint64_t expiry_tick) const
+    {
+        uint64_t difference = expiry_tick ^ current_tick;
+        for (int level = 0; level < level_count; level++)
+        {
+            if ((difference >> (slot_bits * (level + 1))) == 0)
+            {
+                return level * slot_count + (int)((expiry_tick >> (slot_bits * level)) & slot_mask);
+            }
+        }
+        return overflow_slot;
+    }
+
+    void link_node(int index)
+    {
+        Node &node = nodes[index];
+        int slot = get_slot(node.expiry_tick);
+        node.slot = slot;
+        node.prev = -1;
+        node.next = heads[slot];
+        if (heads[slot] >= 0)
+        {
+            nodes[heads[slot]].prev = index;
+        }
+        heads[slot] = index;
+
+        if (slot < overflow_slot)
+        {
+            occupied[slot / slot_count] |= (uint64_t)1 << (slot % slot_count);
+        }
+    }
+
+    void unlink_node(int index)
+    {
+        Node &node = nodes[index];
+        int slot = node.slot;
+        if (node.prev >= 0)
+        {
+            nodes[node.prev].next = node.next;
+        }
+        else
+        {
+            heads[slot] = node.next;
+        }
+        if (node.next >= 0)
+        {
+            nodes[node.next].prev = node.prev;
+        }
+
+        if (heads[slot] < 0 && slot < overflow_slot)
+        {
+            occupied[slot / slot_count] &= ~((uint64_t)1 << (slot % slot_count));
+        }
+    }
+
+    /// Moves the events of every higher-level slot that starts at the current tick
+    /// into lower levels. Higher levels are cascaded first, so events can trickle
+    /// down all the way to level 0 in a single call.
+    void cascade()
+    {
+        for (int level = level_count; level >= 1; level--)
+        {
+            uint64_t level_mask = ((uint64_t)1 << (slot_bits * level)) - 1;
+            if ((current_tick & level_mask) != 0)
+            {
+                continue;
+            }
+
+            int slot = level == level_count
+                           ? overflow_slot
+                           : level * slot_count + (int)((current_tick >> (slot_bits * level)) & slot_mask);
+
+            int index = heads[slot];
+            heads[slot] = -1;
+            if (slot < overflow_slot)
+            {
+                occupied[level] &= ~((uint64_t)1 << (slot % slot_count));
+            }
+
+            while (index >= 0)
+            {
+                int next = nodes[index].next;
+                link_node(index);
+                index = next;
+            }
+        }
+    }
+
+    Vector<Node> nodes;
+    int free_list;
+    int heads[overflow_slot + 1];
+    uint64_t occupied[level_count];
+    uint64_t current_tick;
+    int event_count;
+};
+
+CLICK_ENDDECLS
@@ -1,5 +1,3 @@
 #!/usr/bin/env bash
 
-echo "write router/igmp_multicast_server/igmp.config $@" | telnet localhost 10000
-echo "write router/igmp_client1/igmp.config $@" | telnet localhost 10000
-echo "write router/igmp_client2/igmp.config $@" | telnet localhost 10000
\ No newline at end of file
+echo "write router/igmp.config $@" | telnet localhost 10000
\ No newline at end of file